@@ -0,0 +1,135 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "CookedMesh.h"
+#include "GlbModel.h"
+#include "MeshData.h"
+#include "ObjLoader.h"
+
+/*
+MeshCooker - converts OBJ and glb files into cooked meshes (see CookedMesh) that Mesh::CreateFromCooked loads
+without any parsing. The slow passes (vertex cache, overdraw and fetch optimization, meshlets, levels of detail)
+run here once instead of every time the game starts.
+
+A glb file with several primitives gives one cooked file per primitive: output, output.1, output.2...
+*/
+
+static void PrintUsage()
+{
+	printf("Usage: MeshCooker [options] input.obj|input.glb output.cmesh\n");
+	printf("  --no-optimize    keep the triangle and vertex order of the input\n");
+	printf("  --no-meshlets    do not split the mesh into meshlets\n");
+	printf("  --no-lods        do not generate levels of detail\n");
+	printf("  --byte-indices   allow 8 bit indices for tiny meshes\n");
+	printf("  --normals        generate smooth normals when the input has none\n");
+	printf("  --tangents       generate tangents (and normals) when the input has none\n");
+	printf("  --compress       store vertices and indices compressed (see MeshCodec)\n");
+	printf("  --threads N      threads parsing OBJ files, 0 for one per core\n");
+}
+
+static bool EndsWith(const std::string& text, const char* suffix)
+{
+	size_t length = strlen(suffix);
+	if (text.size() < length)
+		return false;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		if (tolower(text[text.size() - length + i]) != suffix[i])
+			return false;
+	}
+	return true;
+}
+
+static bool Cook(MeshData& data, unsigned int flags, bool compress, const std::string& output)
+{
+	if (!data.Prepare(flags))
+		return false;
+
+	if (!CookedMesh::Write(data, output.c_str(), compress))
+		return false;
+
+	printf("%s: %u vertices, %u triangles, %zu levels of detail, %zu meshlets\n", output.c_str(), data.numOfVertices,
+		data.numOfIndices / 3, data.lodLevels.size(), data.meshlets.size());
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int flags = MeshFlags::OPTIMIZE | MeshFlags::BUILD_MESHLETS | MeshFlags::BUILD_LODS;
+	unsigned int threads = 0;
+	bool compress = false;
+	std::string input, output;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-optimize") == 0)
+			flags &= ~MeshFlags::OPTIMIZE;
+		else if (strcmp(argv[i], "--no-meshlets") == 0)
+			flags &= ~MeshFlags::BUILD_MESHLETS;
+		else if (strcmp(argv[i], "--no-lods") == 0)
+			flags &= ~MeshFlags::BUILD_LODS;
+		else if (strcmp(argv[i], "--byte-indices") == 0)
+			flags |= MeshFlags::BYTE_INDICES;
+		else if (strcmp(argv[i], "--normals") == 0)
+			flags |= MeshFlags::GENERATE_NORMALS;
+		else if (strcmp(argv[i], "--tangents") == 0)
+			flags |= MeshFlags::GENERATE_TANGENTS;
+		else if (strcmp(argv[i], "--compress") == 0)
+			compress = true;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = (unsigned int)atoi(argv[++i]);
+		else if (input.empty())
+			input = argv[i];
+		else if (output.empty())
+			output = argv[i];
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (input.empty() || output.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (EndsWith(input, ".obj"))
+	{
+		MeshData data;
+		if (!ObjLoader::Load(input.c_str(), data, threads))
+			return 1;
+
+		return Cook(data, flags, compress, output) ? 0 : 1;
+	}
+
+	if (EndsWith(input, ".glb"))
+	{
+		GlbModel model;
+		if (!model.Load(input.c_str()))
+			return 1;
+
+		if (model.GetPrimitives().empty())
+		{
+			printf("%s has no mesh to cook!\n", input.c_str());
+			return 1;
+		}
+
+		for (size_t i = 0; i < model.GetPrimitives().size(); i++)
+		{
+			MeshData data;
+			model.GetMeshData(i, data);
+			if (!Cook(data, flags, compress, i == 0 ? output : output + "." + std::to_string(i)))
+				return 1;
+		}
+		return 0;
+	}
+
+	printf("%s is neither an OBJ nor a glb file!\n", input.c_str());
+	return 1;
+}
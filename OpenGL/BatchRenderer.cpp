@@ -0,0 +1,208 @@
+#include "BatchRenderer.h"
+
+BatchRenderer::BatchRenderer()
+{
+	arena = nullptr;
+	maxInstances = 0;
+	multiDrawIndirect = false;
+	lastAllocation = -1;
+
+	indirectBuffer = 0;
+	instanceIndexBuffer = 0;
+	modelBuffer = 0;
+	modelTexture = 0;
+}
+
+bool BatchRenderer::CreateBatchRenderer(GeometryArena* arena, GLsizei maxInstances)
+{
+	ClearBatchRenderer();
+
+	//A model matrix is 4 texels, the shader would read 0 past the limit of the driver
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if ((long long)maxInstances * 4 > maxTexels)
+	{
+		printf("A batch of %d instances needs more than the %d texels of a texture buffer!\n", maxInstances, maxTexels);
+		return false;
+	}
+
+	this->arena = arena;
+	this->maxInstances = maxInstances;
+
+	//Multi draw indirect is GL 4.3, baseInstance moving the instanced attributes needs GL 4.2
+	multiDrawIndirect = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+
+	//The instance index of every instance is just its position in the batch
+	std::vector<GLuint> instanceIndices(maxInstances);
+	for (GLsizei i = 0; i < maxInstances; i++)
+		instanceIndices[i] = i;
+
+	glGenBuffers(1, &instanceIndexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * maxInstances, instanceIndices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//4 texels of RGBA floats per matrix
+	glGenBuffers(1, &modelBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, modelBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * maxInstances, NULL, GL_STREAM_DRAW);
+
+	glGenTextures(1, &modelTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, modelTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, modelBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	if (multiDrawIndirect)
+		glGenBuffers(1, &indirectBuffer);
+
+	return true;
+}
+
+void BatchRenderer::Begin()
+{
+	commands.clear();
+	instanceModels.clear();
+	lastAllocation = -1;
+}
+
+void BatchRenderer::Add(GLint allocation, const glm::mat4* instanceModels, GLuint instanceCount)
+{
+	if (allocation < 0 || instanceCount == 0)
+		return;
+
+	if (this->instanceModels.size() + instanceCount > (size_t)maxInstances)
+	{
+		printf("Batch is full, %u instances skipped!\n", instanceCount);
+		return;
+	}
+
+	this->instanceModels.insert(this->instanceModels.end(), instanceModels, instanceModels + instanceCount);
+
+	//The instances of the previous command are right before these ones, so it can just draw more of them
+	if (allocation == lastAllocation)
+	{
+		commands.back().instanceCount += instanceCount;
+		return;
+	}
+
+	GeometryArena::Range range = arena->GetRange(allocation);
+
+	DrawCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = (GLuint)(this->instanceModels.size() - instanceCount);
+	commands.push_back(command);
+
+	lastAllocation = allocation;
+}
+
+void BatchRenderer::Add(Mesh* mesh, const glm::mat4* instanceModels, GLuint instanceCount)
+{
+	if (mesh->GetArena() != arena)
+	{
+		printf("Mesh is not stored in the arena of this batch!\n");
+		return;
+	}
+
+	Add(mesh->GetArenaAllocation(), instanceModels, instanceCount);
+}
+
+void BatchRenderer::Submit(GLint uniformInstanceModels)
+{
+	if (commands.empty())
+		return;
+
+	//Orphaning and refilling the matrices, the previous frame may still be reading the old ones
+	glBindBuffer(GL_TEXTURE_BUFFER, modelBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * maxInstances, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(glm::mat4) * instanceModels.size(), instanceModels.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + MODEL_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, modelTexture);
+	glUniform1i(uniformInstanceModels, MODEL_TEXTURE_UNIT);
+
+	arena->Bind();
+
+	if (multiDrawIndirect)
+	{
+		//baseInstance of every command moves where the instance index attribute starts reading
+		SetupInstanceIndex(0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * commands.size(), commands.data(), GL_STREAM_DRAW);
+
+		//The whole batch in one call
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)commands.size(), 0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else
+	{
+		//No baseInstance before GL 4.2, so the instance index attribute is moved by hand for every command
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			const DrawCommand& command = commands[i];
+			SetupInstanceIndex(command.baseInstance);
+
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+				(void*)(sizeof(GLuint) * command.firstIndex), command.instanceCount, command.baseVertex);
+		}
+	}
+
+	arena->Unbind();
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void BatchRenderer::ClearBatchRenderer()
+{
+	if (indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &indirectBuffer);
+		indirectBuffer = 0;
+	}
+
+	if (instanceIndexBuffer != 0)
+	{
+		glDeleteBuffers(1, &instanceIndexBuffer);
+		instanceIndexBuffer = 0;
+	}
+
+	if (modelTexture != 0)
+	{
+		glDeleteTextures(1, &modelTexture);
+		modelTexture = 0;
+	}
+
+	if (modelBuffer != 0)
+	{
+		glDeleteBuffers(1, &modelBuffer);
+		modelBuffer = 0;
+	}
+
+	arena = nullptr;
+	maxInstances = 0;
+	Begin();
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	ClearBatchRenderer();
+}
+
+void BatchRenderer::SetupInstanceIndex(GLuint baseInstance)
+{
+	//Expects the arena VAO to be bound, the attribute lives in it next to the vertex positions
+	glBindBuffer(GL_ARRAY_BUFFER, instanceIndexBuffer);
+
+	//The I version keeps the value an integer instead of converting it to float
+	glVertexAttribIPointer(INSTANCE_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)(sizeof(GLuint) * baseInstance));
+	glEnableVertexAttribArray(INSTANCE_INDEX_LOCATION);
+	glVertexAttribDivisor(INSTANCE_INDEX_LOCATION, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
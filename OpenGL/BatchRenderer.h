@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GeometryArena.h"
+#include "Mesh.h"
+
+/*
+Collects the draws of many meshes stored in one GeometryArena and submits them together.
+
+Every draw becomes an indirect command (range of the arena, instance count, base instance). The model matrices
+of all instances go into one texture buffer, and the vertex shader fetches its matrix through the instance index
+(see Shaders/shader_batch.vert), so no uniform is set between draws.
+
+When glMultiDrawElementsIndirect is available the whole batch is a single call, otherwise (plain GL 3.3)
+every command becomes a glDrawElementsInstancedBaseVertex, still without any buffer or uniform change between them.
+*/
+class BatchRenderer
+{
+public:
+	//Same layout as the command glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	BatchRenderer();
+
+	/**
+	* Creates the buffers of the batch.
+	*
+	* @param arena The arena storing every mesh drawn by this batch
+	* @param maxInstances How many instances a single batch can hold
+	* @return false when the model matrices need more texels than GL_MAX_TEXTURE_BUFFER_SIZE, 4 per instance
+	*/
+	bool CreateBatchRenderer(GeometryArena* arena, GLsizei maxInstances);
+
+	/**
+	* Starts a new batch, forgetting the commands of the previous one.
+	*/
+	void Begin();
+
+	/**
+	* Adds copies of a mesh to the batch. Adding the same mesh again right after extends the previous command.
+	*
+	* @param allocation The allocation of the mesh inside the arena
+	* @param instanceModels Array of model matrices, one for each copy
+	* @param instanceCount The number of copies to draw
+	*/
+	void Add(GLint allocation, const glm::mat4* instanceModels, GLuint instanceCount);
+
+	/**
+	* Adds copies of a mesh that has been created inside the arena of this batch.
+	*/
+	void Add(Mesh* mesh, const glm::mat4* instanceModels, GLuint instanceCount);
+
+	/**
+	* Uploads the batch and draws it. The batch shader has to be in use.
+	*
+	* @param uniformInstanceModels Location of the samplerBuffer holding the model matrices in the shader
+	*/
+	void Submit(GLint uniformInstanceModels);
+
+	bool IsMultiDrawIndirectSupported() { return multiDrawIndirect; }
+
+	GLsizei GetCommandCount() { return (GLsizei)commands.size(); }
+
+	/**
+	Clear all buffers from the GPU and sets them back to 0.
+	It does NOT destroy the class BatchRenderer.
+	*/
+	void ClearBatchRenderer();
+
+	~BatchRenderer();
+
+	//Attribute location of the instance index, read as an unsigned int
+	static const GLuint INSTANCE_INDEX_LOCATION = 8;
+
+	//Texture unit the model matrices are bound to while submitting
+	static const GLint MODEL_TEXTURE_UNIT = 0;
+
+private:
+	GeometryArena* arena;
+	GLsizei maxInstances;
+	bool multiDrawIndirect;
+
+	std::vector<DrawCommand> commands;
+	std::vector<glm::mat4> instanceModels;
+	GLint lastAllocation;
+
+	GLuint indirectBuffer;		//the commands, only used with multi draw indirect
+	GLuint instanceIndexBuffer;	//0, 1, 2... one per instance, shifted by baseInstance
+	GLuint modelBuffer;			//the model matrices of every instance
+	GLuint modelTexture;		//texture buffer view of modelBuffer
+
+	void SetupInstanceIndex(GLuint baseInstance);
+};
@@ -0,0 +1,107 @@
+#include "BonePalette.h"
+
+#include <stdio.h>
+
+BonePalette::BonePalette()
+{
+	maxBones = 0;
+	boneBuffer = 0;
+	boneTexture = 0;
+}
+
+bool BonePalette::CreateBonePalette(GLsizei maxBones)
+{
+	ClearBonePalette();
+
+	//A matrix is 4 texels, the shader would read 0 past the limit of the driver
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if ((long long)maxBones * 4 > maxTexels)
+	{
+		printf("A bone palette of %d bones needs more than the %d texels of a texture buffer!\n", maxBones, maxTexels);
+		return false;
+	}
+
+	this->maxBones = maxBones;
+	bones.reserve(maxBones);
+
+	glGenBuffers(1, &boneBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, boneBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * maxBones, NULL, GL_STREAM_DRAW);
+
+	glGenTextures(1, &boneTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, boneTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, boneBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	return true;
+}
+
+void BonePalette::Begin()
+{
+	bones.clear();
+}
+
+GLint BonePalette::AddSkeleton(const glm::mat4* skinMatrices, GLsizei boneCount)
+{
+	if ((GLsizei)bones.size() + boneCount > maxBones)
+	{
+		printf("Bone palette is full, %d bones can not be added!\n", boneCount);
+		return -1;
+	}
+
+	GLint first = (GLint)bones.size();
+	bones.insert(bones.end(), skinMatrices, skinMatrices + boneCount);
+	return first;
+}
+
+void BonePalette::Upload()
+{
+	if (bones.empty())
+		return;
+
+	//Orphaning and refilling the bones, the previous frame may still be reading the old ones
+	glBindBuffer(GL_TEXTURE_BUFFER, boneBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * maxBones, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(glm::mat4) * bones.size(), bones.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void BonePalette::Bind(GLint uniformBones)
+{
+	glActiveTexture(GL_TEXTURE0 + BONE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, boneTexture);
+	glUniform1i(uniformBones, BONE_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void BonePalette::Unbind()
+{
+	glActiveTexture(GL_TEXTURE0 + BONE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void BonePalette::ClearBonePalette()
+{
+	if (boneTexture != 0)
+	{
+		glDeleteTextures(1, &boneTexture);
+		boneTexture = 0;
+	}
+
+	if (boneBuffer != 0)
+	{
+		glDeleteBuffers(1, &boneBuffer);
+		boneBuffer = 0;
+	}
+
+	bones.clear();
+	maxBones = 0;
+}
+
+BonePalette::~BonePalette()
+{
+	ClearBonePalette();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+/*
+The skin matrices of every skeleton drawn in a frame, in one texture buffer the skinned shaders read.
+
+Each skeleton adds its matrices once per frame and gets back the index of its first bone. The vertex shader
+(see Shaders/shader_skinned.vert) fetches the 4 bones of a vertex from boneBase + its joint indices and blends
+them with its weights, so the CPU only computes one matrix per bone, never touches a vertex, and the whole
+palette is uploaded with a single call. Copies of a mesh added one skeleton after the other can be drawn with
+Mesh::RenderMeshInstanced and Shaders/shader_skinned_instanced.vert, each copy reading its own skeleton.
+
+A texture buffer holds far more bones than a uniform block (64 KB, 1024 matrices at best), enough for
+hundreds of characters in one upload.
+*/
+class BonePalette
+{
+public:
+	BonePalette();
+
+	/**
+	* Creates the buffers of the palette.
+	*
+	* @param maxBones Bones of every skeleton drawn in one frame together
+	* @return false when the bones need more texels than GL_MAX_TEXTURE_BUFFER_SIZE, 4 per bone
+	*/
+	bool CreateBonePalette(GLsizei maxBones);
+
+	/**
+	* Starts a new frame, forgetting the skeletons of the previous one.
+	*/
+	void Begin();
+
+	/**
+	* Adds the skin matrices of a skeleton (joint world transform * inverse bind matrix, see GlbModel::ComputeSkinMatrices).
+	*
+	* @return The first bone of the skeleton, for the boneBase uniform, -1 when the palette is full
+	*/
+	GLint AddSkeleton(const glm::mat4* skinMatrices, GLsizei boneCount);
+
+	/**
+	* Uploads every skeleton added since Begin, once per frame before the skinned draws.
+	*/
+	void Upload();
+
+	/**
+	* Binds the palette for the shader in use.
+	*
+	* @param uniformBones Location of the samplerBuffer holding the bones in the shader
+	*/
+	void Bind(GLint uniformBones);
+
+	void Unbind();
+
+	GLsizei GetBoneCount() { return (GLsizei)bones.size(); }
+
+	/**
+	Clear all buffers from the GPU and sets them back to 0.
+	It does NOT destroy the class BonePalette.
+	*/
+	void ClearBonePalette();
+
+	~BonePalette();
+
+	//Texture unit the bones are bound to, after BatchRenderer::MODEL_TEXTURE_UNIT
+	static const GLint BONE_TEXTURE_UNIT = 1;
+
+private:
+	GLsizei maxBones;
+	std::vector<glm::mat4> bones;
+
+	GLuint boneBuffer;		//the matrices of every skeleton, 4 RGBA32F texels (columns) each
+	GLuint boneTexture;		//texture buffer view of boneBuffer
+};
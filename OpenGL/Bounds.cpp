@@ -0,0 +1,137 @@
+#include "Bounds.h"
+
+#include <math.h>
+
+#include "Simd.h"
+
+namespace
+{
+	inline const float* PositionOf(const float* positions, size_t stride, size_t vertex)
+	{
+		return (const float*)((const char*)positions + stride * vertex);
+	}
+
+#ifdef SIMD_SSE2
+	//Every position but the last is read as 4 floats, the 4th is the start of the next vertex and never used
+	inline __m128 LoadPosition(const float* positions, size_t stride, size_t vertex, size_t count)
+	{
+		const float* position = PositionOf(positions, stride, vertex);
+		return vertex + 1 < count ? _mm_loadu_ps(position) : _mm_setr_ps(position[0], position[1], position[2], 0.0f);
+	}
+#endif
+}
+
+Bounds::Bounds()
+{
+	min = glm::vec3(1.0f);
+	max = glm::vec3(-1.0f);
+	centre = glm::vec3(0.0f);
+	radius = 0.0f;
+}
+
+Bounds Bounds::FromPositions(const float* positions, size_t stride, size_t count)
+{
+	Bounds bounds;
+	if (positions == nullptr || count == 0)
+		return bounds;
+
+#ifdef SIMD_SSE2
+	//Two sets of accumulators, so consecutive vertices do not wait on each other
+	__m128 minA = LoadPosition(positions, stride, 0, count);
+	__m128 maxA = minA, minB = minA, maxB = minA;
+
+	size_t i = 1;
+	for (; i + 2 < count; i += 2)
+	{
+		__m128 a = _mm_loadu_ps(PositionOf(positions, stride, i));
+		__m128 b = _mm_loadu_ps(PositionOf(positions, stride, i + 1));
+		minA = _mm_min_ps(minA, a);
+		maxA = _mm_max_ps(maxA, a);
+		minB = _mm_min_ps(minB, b);
+		maxB = _mm_max_ps(maxB, b);
+	}
+	for (; i < count; i++)
+	{
+		__m128 a = LoadPosition(positions, stride, i, count);
+		minA = _mm_min_ps(minA, a);
+		maxA = _mm_max_ps(maxA, a);
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_min_ps(minA, minB));
+	bounds.min = glm::vec3(lanes[0], lanes[1], lanes[2]);
+	_mm_storeu_ps(lanes, _mm_max_ps(maxA, maxB));
+	bounds.max = glm::vec3(lanes[0], lanes[1], lanes[2]);
+	bounds.centre = (bounds.min + bounds.max) * 0.5f;
+
+	//The 4th lane is masked off before squaring, it holds whatever follows the position
+	__m128 centre = _mm_setr_ps(bounds.centre.x, bounds.centre.y, bounds.centre.z, 0.0f);
+	__m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 farthest = _mm_setzero_ps();
+	for (i = 0; i < count; i++)
+	{
+		__m128 offset = _mm_and_ps(_mm_sub_ps(LoadPosition(positions, stride, i, count), centre), mask);
+		__m128 squares = _mm_mul_ps(offset, offset);
+		__m128 sum = _mm_add_ps(squares, _mm_movehl_ps(squares, squares));
+		farthest = _mm_max_ss(farthest, _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+	bounds.radius = sqrtf(_mm_cvtss_f32(farthest));
+#else
+	bounds.min = glm::vec3(positions[0], positions[1], positions[2]);
+	bounds.max = bounds.min;
+	for (size_t i = 1; i < count; i++)
+	{
+		const float* position = PositionOf(positions, stride, i);
+		bounds.min = glm::min(bounds.min, glm::vec3(position[0], position[1], position[2]));
+		bounds.max = glm::max(bounds.max, glm::vec3(position[0], position[1], position[2]));
+	}
+	bounds.centre = (bounds.min + bounds.max) * 0.5f;
+
+	float farthest = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const float* position = PositionOf(positions, stride, i);
+		glm::vec3 offset = glm::vec3(position[0], position[1], position[2]) - bounds.centre;
+		farthest = glm::max(farthest, glm::dot(offset, offset));
+	}
+	bounds.radius = sqrtf(farthest);
+#endif
+
+	return bounds;
+}
+
+Bounds Bounds::FromBox(const glm::vec3& min, const glm::vec3& max)
+{
+	Bounds bounds;
+	bounds.min = min;
+	bounds.max = max;
+	bounds.centre = (min + max) * 0.5f;
+	bounds.radius = glm::length(max - min) * 0.5f;
+	return bounds;
+}
+
+Bounds Bounds::Transform(const glm::mat4& model) const
+{
+	if (IsEmpty())
+		return *this;
+
+	//Each axis of the matrix moves the box by its smallest and largest product with the box (Arvo)
+	Bounds world;
+	world.min = glm::vec3(model[3]);
+	world.max = world.min;
+	for (int column = 0; column < 3; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			float a = model[column][row] * min[column];
+			float b = model[column][row] * max[column];
+			world.min[row] += glm::min(a, b);
+			world.max[row] += glm::max(a, b);
+		}
+	}
+
+	float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	world.centre = glm::vec3(model * glm::vec4(centre, 1.0f));
+	world.radius = radius * scale;
+	return world;
+}
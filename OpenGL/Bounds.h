@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+/*
+The volume a mesh takes: an axis aligned box and a sphere around it, in the space of its positions.
+Culling tests the cheap sphere first and the tighter box after (see Frustum).
+*/
+struct Bounds
+{
+	glm::vec3 min, max;
+	glm::vec3 centre;
+	float radius;
+
+	/*Empty: min above max, no radius*/
+	Bounds();
+
+	bool IsEmpty() const { return min.x > max.x; }
+
+	/**
+	* Box and sphere around positions, a whole position per instruction where Simd.h finds SSE2.
+	* The sphere is centred on the box and reaches the farthest position, tighter than the box corners.
+	*
+	* @param positions Position of the first vertex, 3 floats
+	* @param stride Bytes from one position to the next, at least 12
+	*/
+	static Bounds FromPositions(const float* positions, size_t stride, size_t count);
+
+	/**
+	* Bounds of a box alone, the sphere goes through its corners.
+	*/
+	static Bounds FromBox(const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	* Moves the bounds into world space with the model matrix the mesh is drawn with.
+	* The box grows to hold the rotated box (Arvo), the sphere grows with the largest scale of the matrix.
+	*/
+	Bounds Transform(const glm::mat4& model) const;
+};
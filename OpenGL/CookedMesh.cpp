@@ -0,0 +1,358 @@
+#include "CookedMesh.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+#include "MappedFile.h"
+#include "MeshCodec.h"
+
+//The tables are written and read as they are in memory, their layout must not change between compilers
+static_assert(sizeof(CookedMesh::Header) == 104, "Cooked header layout changed");
+static_assert(sizeof(CookedMesh::Attribute) == 32, "Cooked attribute layout changed");
+static_assert(sizeof(CookedMesh::Stream) == 16, "Cooked stream layout changed");
+static_assert(sizeof(LODLevel) == 12, "LODLevel layout changed");
+static_assert(sizeof(Meshlet) == 40, "Meshlet layout changed");
+
+namespace
+{
+	size_t Align(size_t offset)
+	{
+		return (offset + CookedMesh::BLOB_ALIGNMENT - 1) & ~(CookedMesh::BLOB_ALIGNMENT - 1);
+	}
+
+	template<typename T>
+	void Append(std::vector<unsigned char>& bytes, const T* values, size_t count)
+	{
+		size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(T) * count);
+		if (count > 0)
+			memcpy(bytes.data() + offset, values, sizeof(T) * count);
+	}
+
+	//offset + length <= size, without the sum overflowing on a damaged file
+	bool FitsIn(unsigned long long offset, unsigned long long length, unsigned long long size)
+	{
+		return offset <= size && length <= size - offset;
+	}
+}
+
+bool CookedMesh::Write(const MeshData& data, const char* path, bool compress)
+{
+	const VertexLayout& layout = data.layout;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.numOfVertices = data.numOfVertices;
+	header.indexType = data.indexType;
+	header.numOfIndices = data.numOfIndices;
+	header.totalIndices = data.GetTotalIndexCount();
+	header.attributeCount = (unsigned int)layout.GetAttributes().size();
+	header.streamCount = layout.GetStreamCount();
+	header.lodCount = (unsigned int)data.lodLevels.size();
+	header.meshletCount = (unsigned int)data.meshlets.size();
+	header.flags = compress ? COMPRESSED : 0;
+
+	GLsizei positionStride = 0;
+	std::vector<const void*> streams = data.GetStreamPointers();
+	const float* positions = layout.FindPositions(streams.data(), positionStride);
+	Bounds bounds = Bounds::FromPositions(positions, positionStride, data.numOfVertices);
+	header.boundsRadius = bounds.radius;
+	for (int k = 0; k < 3; k++)
+	{
+		header.boundsMin[k] = bounds.min[k];
+		header.boundsMax[k] = bounds.max[k];
+	}
+
+	std::vector<Attribute> attributes(header.attributeCount);
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const VertexAttribute& source = layout.GetAttributes()[i];
+		attributes[i].location = source.location;
+		attributes[i].components = source.components;
+		attributes[i].type = source.type;
+		attributes[i].normalized = source.normalized;
+		attributes[i].integer = source.integer ? 1 : 0;
+		attributes[i].stream = source.stream;
+		attributes[i].offset = source.offset;
+		attributes[i].size = source.size;
+	}
+
+	//The streams are placed the way Mesh places them in its VBO
+	std::vector<Stream> streamTable(header.streamCount);
+	size_t vertexSize = 0;
+	for (GLuint i = 0; i < header.streamCount; i++)
+	{
+		streamTable[i].stride = layout.GetStride(i);
+		streamTable[i].encodedSize = 0;
+		streamTable[i].offset = vertexSize;
+		vertexSize += Align((size_t)layout.GetStreamSize(i, data.numOfVertices));
+	}
+
+	std::vector<unsigned char> vertexBlob, indexBlob;
+	if (compress)
+	{
+		for (GLuint i = 0; i < header.streamCount; i++)
+		{
+			size_t start = vertexBlob.size();
+			size_t stride = streamTable[i].stride;
+			if (MeshCodec::IsStrideSupported(stride))
+			{
+				vertexBlob.resize(start + MeshCodec::GetVertexBound(data.numOfVertices, stride));
+				vertexBlob.resize(start + MeshCodec::EncodeVertices(vertexBlob.data() + start, vertexBlob.size() - start,
+					data.streams[i].data(), data.numOfVertices, stride));
+			}
+			else
+				Append(vertexBlob, data.streams[i].data(), data.streams[i].size());
+
+			streamTable[i].encodedSize = (unsigned int)(vertexBlob.size() - start);
+		}
+
+		std::vector<unsigned int> indices(header.totalIndices);
+		for (unsigned int i = 0; i < header.totalIndices; i++)
+			indices[i] = IndexFormat::Read(data.indices.data(), data.indexType, i);
+
+		indexBlob.resize(MeshCodec::GetIndexBound(indices.size()));
+		indexBlob.resize(MeshCodec::EncodeIndices(indexBlob.data(), indexBlob.size(), indices.data(), indices.size()));
+	}
+	else
+	{
+		vertexBlob.resize(vertexSize, 0);
+		for (GLuint i = 0; i < header.streamCount; i++)
+		{
+			if (!data.streams[i].empty())
+				memcpy(vertexBlob.data() + streamTable[i].offset, data.streams[i].data(), data.streams[i].size());
+		}
+		indexBlob = data.indices;
+	}
+
+	std::vector<unsigned char> bytes;
+	Append(bytes, &header, 1);
+	Append(bytes, attributes.data(), attributes.size());
+	Append(bytes, streamTable.data(), streamTable.size());
+	Append(bytes, data.lodLevels.data(), data.lodLevels.size());
+	Append(bytes, data.meshlets.data(), data.meshlets.size());
+
+	header.vertexOffset = Align(bytes.size());
+	header.vertexSize = vertexBlob.size();
+	header.indexOffset = Align((size_t)(header.vertexOffset + header.vertexSize));
+	header.indexSize = indexBlob.size();
+
+	bytes.resize((size_t)(header.indexOffset + header.indexSize), 0);
+	memcpy(bytes.data(), &header, sizeof(header));
+	if (!vertexBlob.empty())
+		memcpy(bytes.data() + header.vertexOffset, vertexBlob.data(), vertexBlob.size());
+	if (!indexBlob.empty())
+		memcpy(bytes.data() + header.indexOffset, indexBlob.data(), indexBlob.size());
+
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	if (!file.is_open())
+	{
+		printf("Failed to write %s!\n", path);
+		return false;
+	}
+
+	file.write((const char*)bytes.data(), bytes.size());
+	return file.good();
+}
+
+bool CookedMesh::Read(const void* cooked, size_t size, View& view)
+{
+	const unsigned char* bytes = (const unsigned char*)cooked;
+	if (size < sizeof(Header))
+	{
+		printf("Cooked mesh is cut short!\n");
+		return false;
+	}
+
+	//Copied, so the file does not have to be aligned in memory
+	Header& header = view.header;
+	memcpy(&header, bytes, sizeof(header));
+	if (header.magic != MAGIC || header.version != VERSION)
+	{
+		printf("Not a cooked mesh of version %u!\n", VERSION);
+		return false;
+	}
+
+	//Summed in 64 bits, a size_t would wrap on 32 bit builds
+	unsigned long long tablesSize = sizeof(Header) + sizeof(Attribute) * (unsigned long long)header.attributeCount +
+		sizeof(Stream) * (unsigned long long)header.streamCount + sizeof(LODLevel) * (unsigned long long)header.lodCount +
+		sizeof(Meshlet) * (unsigned long long)header.meshletCount;
+	bool indexTypeValid = header.indexType == GL_UNSIGNED_BYTE || header.indexType == GL_UNSIGNED_SHORT || header.indexType == GL_UNSIGNED_INT;
+	bool compressed = (header.flags & COMPRESSED) != 0;
+
+	if (tablesSize > size || !FitsIn(header.vertexOffset, header.vertexSize, size) || !FitsIn(header.indexOffset, header.indexSize, size) || !indexTypeValid ||
+		(!compressed && header.indexSize != (unsigned long long)IndexFormat::GetSize(header.indexType) * header.totalIndices) ||
+		header.numOfIndices > header.totalIndices)
+	{
+		printf("Cooked mesh is cut short or damaged!\n");
+		return false;
+	}
+
+	const unsigned char* table = bytes + sizeof(Header);
+
+	std::vector<Attribute> attributes(header.attributeCount);
+	memcpy(attributes.data(), table, sizeof(Attribute) * attributes.size());
+	table += sizeof(Attribute) * attributes.size();
+
+	std::vector<Stream> streams(header.streamCount);
+	memcpy(streams.data(), table, sizeof(Stream) * streams.size());
+	table += sizeof(Stream) * streams.size();
+
+	view.lodLevels.resize(header.lodCount);
+	memcpy(view.lodLevels.data(), table, sizeof(LODLevel) * view.lodLevels.size());
+	table += sizeof(LODLevel) * view.lodLevels.size();
+
+	view.meshlets.resize(header.meshletCount);
+	memcpy(view.meshlets.data(), table, sizeof(Meshlet) * view.meshlets.size());
+
+	view.layout = VertexLayout();
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const Attribute& attribute = attributes[i];
+		if (attribute.stream >= header.streamCount || !FitsIn(attribute.offset, attribute.size, streams[attribute.stream].stride))
+		{
+			printf("Cooked mesh is damaged!\n");
+			return false;
+		}
+
+		view.layout.AddAttributeAt(attribute.location, attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE,
+			attribute.integer != 0, attribute.size, attribute.stream, attribute.offset);
+	}
+
+	view.streamOffsets.resize(header.streamCount);
+	view.encodedSizes.resize(header.streamCount);
+	unsigned long long encodedSize = 0;
+	for (GLuint i = 0; i < header.streamCount; i++)
+	{
+		view.layout.SetStride(i, streams[i].stride);
+		view.streamOffsets[i] = (GLintptr)streams[i].offset;
+		view.encodedSizes[i] = streams[i].encodedSize;
+
+		if ((compressed && !FitsIn(encodedSize, streams[i].encodedSize, header.vertexSize)) ||
+			(!compressed && !FitsIn(streams[i].offset, (unsigned long long)streams[i].stride * header.numOfVertices, header.vertexSize)) ||
+			(compressed && !MeshCodec::IsStrideSupported(streams[i].stride) && streams[i].encodedSize != (unsigned long long)streams[i].stride * header.numOfVertices))
+		{
+			printf("Cooked mesh is damaged!\n");
+			return false;
+		}
+		encodedSize += streams[i].encodedSize;
+	}
+
+	if (compressed && encodedSize != header.vertexSize)
+	{
+		printf("Cooked mesh is damaged!\n");
+		return false;
+	}
+
+	for (size_t i = 0; i < view.lodLevels.size(); i++)
+	{
+		if ((unsigned long long)view.lodLevels[i].firstIndex + view.lodLevels[i].indexCount > header.totalIndices)
+		{
+			printf("Cooked mesh is damaged!\n");
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < view.meshlets.size(); i++)
+	{
+		if ((unsigned long long)view.meshlets[i].firstIndex + view.meshlets[i].indexCount > header.numOfIndices)
+		{
+			printf("Cooked mesh is damaged!\n");
+			return false;
+		}
+	}
+
+	view.vertices = bytes + header.vertexOffset;
+	view.indices = bytes + header.indexOffset;
+
+	//Uncompressed indices go to the GPU as they are, compressed ones are checked once decoded
+	if (!compressed && !IndexFormat::CheckTriangles(view.indices, header.indexType, (size_t)header.totalIndices, header.numOfVertices))
+	{
+		printf("Cooked mesh has indices outside of its vertices!\n");
+		return false;
+	}
+
+	view.bounds = Bounds();
+	if (header.boundsMin[0] <= header.boundsMax[0])
+	{
+		view.bounds = Bounds::FromBox(glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+			glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]));
+		view.bounds.radius = header.boundsRadius;
+	}
+	return true;
+}
+
+bool CookedMesh::Decode(const View& view, MeshData& data)
+{
+	const Header& header = view.header;
+	bool compressed = (header.flags & COMPRESSED) != 0;
+
+	data = MeshData();
+	data.layout = view.layout;
+	data.numOfVertices = header.numOfVertices;
+	data.streams.resize(header.streamCount);
+
+	const unsigned char* encoded = (const unsigned char*)view.vertices;
+	for (GLuint i = 0; i < header.streamCount; i++)
+	{
+		size_t stride = (size_t)view.layout.GetStride(i);
+		std::vector<unsigned char>& stream = data.streams[i];
+		stream.resize(stride * header.numOfVertices);
+
+		if (compressed && MeshCodec::IsStrideSupported(stride))
+		{
+			if (!MeshCodec::DecodeVertices(stream.data(), header.numOfVertices, stride, encoded, view.encodedSizes[i]))
+			{
+				printf("Cooked mesh is damaged!\n");
+				return false;
+			}
+		}
+		else if (!stream.empty())
+			memcpy(stream.data(), compressed ? encoded : (const unsigned char*)view.vertices + view.streamOffsets[i], stream.size());
+
+		encoded += view.encodedSizes[i];
+	}
+
+	data.indexType = header.indexType;
+	data.numOfIndices = header.numOfIndices;
+	data.indices.resize(IndexFormat::GetSize(header.indexType) * (size_t)header.totalIndices);
+	if (compressed)
+	{
+		if (!MeshCodec::DecodeIndices(data.indices.data(), header.indexType, header.totalIndices, (const unsigned char*)view.indices, (size_t)header.indexSize))
+		{
+			printf("Cooked mesh is damaged!\n");
+			return false;
+		}
+	}
+	else if (!data.indices.empty())
+		memcpy(data.indices.data(), view.indices, data.indices.size());
+
+	if (compressed && !IndexFormat::CheckTriangles(data.indices.data(), header.indexType, (size_t)header.totalIndices, header.numOfVertices))
+	{
+		printf("Cooked mesh has indices outside of its vertices!\n");
+		return false;
+	}
+
+	//Everything Prepare would compute was cooked in
+	data.prepared = true;
+	data.lodLevels = view.lodLevels;
+	data.meshlets = view.meshlets;
+	data.bounds = view.bounds;
+	return true;
+}
+
+bool CookedMesh::Load(const char* path, MeshData& data)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	View view;
+	if (!Read(file.GetData(), file.GetSize(), view))
+		return false;
+
+	return Decode(view, data);
+}
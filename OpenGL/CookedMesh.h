@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "MeshData.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+
+/*
+A mesh stored the way the GPU wants it, written by the MeshCooker tool and read with Mesh::CreateFromCooked.
+
+	Header
+	Attribute[attributeCount]
+	Stream[streamCount]
+	LODLevel[lodCount]
+	Meshlet[meshletCount]
+	vertex blob (16 byte aligned): every stream, already placed where Mesh puts them in its VBO
+	index blob (16 byte aligned): indices in their final type, LOD chain included
+
+Loading is mapping the file and handing both blobs to glBufferData, there is nothing to parse or convert.
+Every value is little endian.
+
+A COMPRESSED file stores both blobs through MeshCodec instead: the streams are encoded one after the other
+(Stream::encodedSize bytes each) and the indices as one run. Decode them with Load or Decode on a loader thread,
+a MeshUploader for instance, and create the mesh from the MeshData.
+*/
+namespace CookedMesh
+{
+	const unsigned int MAGIC = 0x48534D43;		//"CMSH"
+	const unsigned int VERSION = 3;
+	const size_t BLOB_ALIGNMENT = 16;
+
+	//Header::flags
+	const unsigned int COMPRESSED = 1 << 0;
+
+	struct Header
+	{
+		unsigned int magic;
+		unsigned int version;
+
+		unsigned int numOfVertices;
+		unsigned int indexType;
+		unsigned int numOfIndices;		//full detail mesh
+		unsigned int totalIndices;		//LOD chain included
+
+		unsigned int attributeCount;
+		unsigned int streamCount;
+		unsigned int lodCount;
+		unsigned int meshletCount;
+		unsigned int flags;
+
+		float boundsRadius;		//sphere centred on the box
+		float boundsMin[3];
+		float boundsMax[3];
+
+		unsigned long long vertexOffset;	//from the start of the file
+		unsigned long long vertexSize;		//bytes stored in the file, compressed or not
+		unsigned long long indexOffset;
+		unsigned long long indexSize;
+	};
+
+	struct Attribute
+	{
+		unsigned int location;
+		unsigned int components;
+		unsigned int type;
+		unsigned int normalized;
+		unsigned int integer;
+		unsigned int stream;
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	struct Stream
+	{
+		unsigned int stride;
+		unsigned int encodedSize;		//bytes in the compressed vertex blob, 0 when not compressed
+		unsigned long long offset;		//from the start of the uncompressed vertex blob
+	};
+
+	//A cooked file checked and mapped onto its parts, pointing inside the file
+	struct View
+	{
+		Header header;
+		VertexLayout layout;
+		std::vector<GLintptr> streamOffsets;
+		std::vector<size_t> encodedSizes;
+		const void* vertices;
+		const void* indices;
+		std::vector<LODLevel> lodLevels;
+		std::vector<Meshlet> meshlets;
+		Bounds bounds;
+	};
+
+	/**
+	* Writes a mesh to a cooked file, the data should be prepared first (MeshData::Prepare).
+	* The bounds are left empty when the positions are not stored as 3 floats.
+	*
+	* @param compress Stores the vertices and indices through MeshCodec, streams with a stride MeshCodec does not support are stored as they are
+	*
+	* @return false when the file can not be written
+	*/
+	bool Write(const MeshData& data, const char* path, bool compress = false);
+
+	/**
+	* Checks a cooked file in memory and finds its parts.
+	*
+	* @return false when it is not a cooked file of this version or it is cut short
+	*/
+	bool Read(const void* cooked, size_t size, View& view);
+
+	/**
+	* Copies a cooked file into data, prepared and ready for Mesh::CreateMesh, decompressing it when needed.
+	* Needs no OpenGL context.
+	*
+	* @return false when the compressed blobs are damaged
+	*/
+	bool Decode(const View& view, MeshData& data);
+
+	/**
+	* Maps a cooked file and decodes it into data (see Decode), meant to be the load function of a MeshUploader.
+	*
+	* @return false when the file can not be read or is damaged
+	*/
+	bool Load(const char* path, MeshData& data);
+}
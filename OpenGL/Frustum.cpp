@@ -0,0 +1,59 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void Frustum::ExtractPlanes(const glm::mat4& matrix)
+{
+	//glm is column major, so the rows of the matrix are read across the columns
+	glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+	//A point is inside when -w <= x, y, z <= w in clip space
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	//Normalizing, so the plane equation gives real distances that can be compared with a radius
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+			planes[i] /= length;
+	}
+}
+
+bool Frustum::IsSphereVisible(const glm::vec3& centre, float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), centre) + planes[i].w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		//The corner of the box furthest along the plane normal, if it is outside the whole box is
+		glm::vec3 corner(planes[i].x >= 0.0f ? max.x : min.x,
+			planes[i].y >= 0.0f ? max.y : min.y,
+			planes[i].z >= 0.0f ? max.z : min.z);
+
+		if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
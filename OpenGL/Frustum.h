@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+The six planes of the volume a camera can see.
+Planes point inwards: a point is inside a plane when dot(plane.xyz, point) + plane.w >= 0.
+*/
+class Frustum
+{
+public:
+	Frustum();
+
+	/**
+	* Extracts the planes from a matrix (Gribb and Hartmann).
+	* With projection * view the planes are in world space, with projection * view * model they are in the
+	* object space of that model.
+	*/
+	void ExtractPlanes(const glm::mat4& matrix);
+
+	/**
+	* @return false when the sphere is completely outside one of the planes
+	*/
+	bool IsSphereVisible(const glm::vec3& centre, float radius) const;
+
+	/**
+	* @return false when the box is completely outside one of the planes
+	*/
+	bool IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const;
+
+	const glm::vec4& GetPlane(int i) const { return planes[i]; }
+
+	static const int PLANE_COUNT = 6;
+
+private:
+	//left, right, bottom, top, near, far
+	glm::vec4 planes[PLANE_COUNT];
+};
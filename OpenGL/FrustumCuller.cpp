@@ -0,0 +1,167 @@
+#include "FrustumCuller.h"
+
+#include <float.h>
+
+#include "Parallel.h"
+#include "Simd.h"
+
+FrustumCuller::FrustumCuller()
+{
+	count = 0;
+}
+
+void FrustumCuller::Reserve(size_t count)
+{
+	size_t padded = (count + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+	std::vector<float>* arrays[] = { &centreX, &centreY, &centreZ, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ };
+	for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+		arrays[i]->reserve(padded);
+}
+
+unsigned int FrustumCuller::Add(const Bounds& worldBounds)
+{
+	//A new group starts with 4 padding objects, the new object takes the first of them
+	if (count % GROUP_SIZE == 0)
+	{
+		std::vector<float>* arrays[] = { &centreX, &centreY, &centreZ, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ };
+		for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+			arrays[i]->resize(count + GROUP_SIZE, 0.0f);
+	}
+
+	unsigned int object = (unsigned int)count++;
+	Update(object, worldBounds);
+	return object;
+}
+
+void FrustumCuller::Update(unsigned int object, const Bounds& worldBounds)
+{
+	//Huge but finite, so the plane products never become inf - inf
+	Bounds bounds = worldBounds;
+	if (bounds.IsEmpty())
+	{
+		bounds.min = glm::vec3(-FLT_MAX);
+		bounds.max = glm::vec3(FLT_MAX);
+		bounds.centre = glm::vec3(0.0f);
+		bounds.radius = FLT_MAX;
+	}
+
+	centreX[object] = bounds.centre.x;
+	centreY[object] = bounds.centre.y;
+	centreZ[object] = bounds.centre.z;
+	radius[object] = bounds.radius;
+	minX[object] = bounds.min.x;
+	minY[object] = bounds.min.y;
+	minZ[object] = bounds.min.z;
+	maxX[object] = bounds.max.x;
+	maxY[object] = bounds.max.y;
+	maxZ[object] = bounds.max.z;
+}
+
+const std::vector<unsigned int>& FrustumCuller::Cull(const glm::mat4& viewProjection, unsigned int threadCount)
+{
+	frustum.ExtractPlanes(viewProjection);
+	visible.clear();
+
+	size_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+	threadCount = Parallel::GetThreadCount(threadCount);
+	if (threadCount <= 1 || groupCount < threadCount)
+	{
+		CullGroups(0, groupCount, visible);
+		return visible;
+	}
+
+	//Each thread takes a contiguous range of groups, joining the ranges in order keeps the list sorted
+	if (threadVisible.size() < threadCount)
+		threadVisible.resize(threadCount);
+
+	Parallel::For(groupCount, threadCount, [this](size_t begin, size_t end, unsigned int thread)
+	{
+		threadVisible[thread].clear();
+		CullGroups(begin, end, threadVisible[thread]);
+	});
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		visible.insert(visible.end(), threadVisible[i].begin(), threadVisible[i].end());
+
+	return visible;
+}
+
+void FrustumCuller::CullGroups(size_t firstGroup, size_t lastGroup, std::vector<unsigned int>& result) const
+{
+#ifdef SIMD_SSE2
+	//Every plane value repeated in the 4 lanes
+	__m128 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeW[Frustum::PLANE_COUNT];
+	for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+	{
+		const glm::vec4& plane = frustum.GetPlane(p);
+		planeX[p] = _mm_set1_ps(plane.x);
+		planeY[p] = _mm_set1_ps(plane.y);
+		planeZ[p] = _mm_set1_ps(plane.z);
+		planeW[p] = _mm_set1_ps(plane.w);
+	}
+
+	__m128 zero = _mm_setzero_ps();
+	for (size_t group = firstGroup; group < lastGroup; group++)
+	{
+		size_t first = group * GROUP_SIZE;
+
+		//Spheres: outside when the distance to a plane is below -radius
+		__m128 x = _mm_loadu_ps(&centreX[first]);
+		__m128 y = _mm_loadu_ps(&centreY[first]);
+		__m128 z = _mm_loadu_ps(&centreZ[first]);
+		__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(&radius[first]));
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		if (_mm_movemask_ps(inside) == 0)
+			continue;
+
+		//Boxes: outside when the corner furthest along the plane normal is behind it.
+		//The corner only depends on the signs of the plane, so it is the same for the 4 boxes
+		__m128 lowX = _mm_loadu_ps(&minX[first]), highX = _mm_loadu_ps(&maxX[first]);
+		__m128 lowY = _mm_loadu_ps(&minY[first]), highY = _mm_loadu_ps(&maxY[first]);
+		__m128 lowZ = _mm_loadu_ps(&minZ[first]), highZ = _mm_loadu_ps(&maxZ[first]);
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			const glm::vec4& plane = frustum.GetPlane(p);
+			__m128 cornerX = plane.x >= 0.0f ? highX : lowX;
+			__m128 cornerY = plane.y >= 0.0f ? highY : lowY;
+			__m128 cornerZ = plane.z >= 0.0f ? highZ : lowZ;
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cornerX), _mm_mul_ps(planeY[p], cornerY)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], cornerZ), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (size_t lane = 0; lane < GROUP_SIZE; lane++)
+		{
+			if ((mask & (1 << lane)) && first + lane < count)
+				result.push_back((unsigned int)(first + lane));
+		}
+	}
+#else
+	for (size_t object = firstGroup * GROUP_SIZE; object < lastGroup * GROUP_SIZE && object < count; object++)
+	{
+		if (frustum.IsSphereVisible(glm::vec3(centreX[object], centreY[object], centreZ[object]), radius[object]) &&
+			frustum.IsBoxVisible(glm::vec3(minX[object], minY[object], minZ[object]), glm::vec3(maxX[object], maxY[object], maxZ[object])))
+			result.push_back((unsigned int)object);
+	}
+#endif
+}
+
+void FrustumCuller::ClearCuller()
+{
+	std::vector<float>* arrays[] = { &centreX, &centreY, &centreZ, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ };
+	for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+		std::vector<float>().swap(*arrays[i]);
+
+	std::vector<unsigned int>().swap(visible);
+	threadVisible.clear();
+	count = 0;
+}
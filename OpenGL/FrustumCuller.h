@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+/*
+Culls many objects against the camera at once.
+
+The world bounds of the objects are stored as structure of arrays (every centre x together, every radius
+together...), so one SSE2 instruction tests 4 objects against a plane. Each group of 4 is first tested with
+its spheres, and only when one of them survives with its boxes, which are tighter.
+
+Cull writes the indices of the visible objects, in the order they were added, and the draw loop only walks
+through them. Large scenes can split the test across threads, the list comes out the same.
+*/
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	/**
+	* Makes room for a number of objects, so adding them does not grow the arrays.
+	*/
+	void Reserve(size_t count);
+
+	/**
+	* Adds an object, empty bounds are always visible.
+	*
+	* @param worldBounds The bounds in world space, see Mesh::GetWorldBounds
+	* @return The index of the object, the one Cull writes when it is visible
+	*/
+	unsigned int Add(const Bounds& worldBounds);
+
+	/**
+	* Changes the bounds of an object that has moved.
+	*/
+	void Update(unsigned int object, const Bounds& worldBounds);
+
+	/**
+	* Tests every object against the planes of a matrix.
+	*
+	* @param viewProjection projection * view, the bounds are tested in the space before it
+	* @param threadCount Threads to use, 0 for one per core; worth it past tens of thousands of objects
+	* @return The indices of the visible objects in increasing order, valid until the next Cull
+	*/
+	const std::vector<unsigned int>& Cull(const glm::mat4& viewProjection, unsigned int threadCount = 1);
+
+	const std::vector<unsigned int>& GetVisible() { return visible; }
+
+	size_t GetCount() { return count; }
+
+	/**
+	Forgets every object and frees the arrays.
+	It does NOT destroy the class FrustumCuller.
+	*/
+	void ClearCuller();
+
+	//Objects tested together, the arrays are padded to a multiple of it
+	static const size_t GROUP_SIZE = 4;
+
+private:
+	size_t count;
+
+	//One array per value, padded with always visible bounds
+	std::vector<float> centreX, centreY, centreZ, radius;
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+
+	Frustum frustum;
+	std::vector<unsigned int> visible;
+	std::vector<std::vector<unsigned int> > threadVisible;		//what each thread found, joined in order afterwards
+
+	void CullGroups(size_t firstGroup, size_t lastGroup, std::vector<unsigned int>& result) const;
+};
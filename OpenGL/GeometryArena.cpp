@@ -0,0 +1,325 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+GeometryArena::GeometryArena()
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	vertexCapacity = 0;
+	indexCapacity = 0;
+}
+
+void GeometryArena::CreateArena(GLsizei vertexCapacity, GLsizei indexCapacity)
+{
+	ClearArena();
+
+	glGenVertexArrays(1, &VAO);
+
+	//Rebuilding from empty buffers just allocates them with the requested size
+	Rebuild(vertexCapacity, indexCapacity);
+}
+
+GLint GeometryArena::Allocate(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices)
+{
+	if (VAO == 0)
+	{
+		printf("Geometry arena has not been created!\n");
+		return -1;
+	}
+
+	GLsizei vertexCount = numOfVertices / VERTEX_SIZE;
+	GLsizei indexCount = numOfIndices;
+
+	if (vertexCount == 0 || indexCount == 0)
+		return -1;
+
+	GLint vertexOffset = AllocateBlock(freeVertices, vertexCount);
+	GLint indexOffset = AllocateBlock(freeIndices, indexCount);
+
+	if (vertexOffset < 0 || indexOffset < 0)
+	{
+		//Giving back the half that did fit, the rebuild below repacks everything anyway
+		if (vertexOffset >= 0)
+			FreeBlock(freeVertices, vertexOffset, vertexCount);
+		if (indexOffset >= 0)
+			FreeBlock(freeIndices, indexOffset, indexCount);
+
+		GLsizei usedVertices = 0, usedIndices = 0;
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			if (!rangeUsed[i])
+				continue;
+			usedVertices += ranges[i].vertexCount;
+			usedIndices += ranges[i].indexCount;
+		}
+
+		//Compacting alone might be enough, otherwise the buffers double until the mesh fits
+		GLsizei newVertexCapacity = std::max(vertexCapacity, (GLsizei)1);
+		GLsizei newIndexCapacity = std::max(indexCapacity, (GLsizei)1);
+		while (newVertexCapacity - usedVertices < vertexCount)
+			newVertexCapacity *= 2;
+		while (newIndexCapacity - usedIndices < indexCount)
+			newIndexCapacity *= 2;
+
+		Rebuild(newVertexCapacity, newIndexCapacity);
+
+		vertexOffset = AllocateBlock(freeVertices, vertexCount);
+		indexOffset = AllocateBlock(freeIndices, indexCount);
+	}
+
+	//Copying the data into its range, through the copy target so no VAO state is touched
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(GLfloat) * VERTEX_SIZE * vertexOffset, sizeof(GLfloat) * VERTEX_SIZE * vertexCount, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, IBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * indexOffset, sizeof(GLuint) * indexCount, indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	Range range;
+	range.baseVertex = vertexOffset;
+	range.firstIndex = indexOffset;
+	range.vertexCount = vertexCount;
+	range.indexCount = indexCount;
+
+	//Reusing the id of a freed allocation, so the table does not keep growing
+	GLint allocation;
+	if (!freeIds.empty())
+	{
+		allocation = freeIds.back();
+		freeIds.pop_back();
+		ranges[allocation] = range;
+		rangeUsed[allocation] = true;
+	}
+	else
+	{
+		allocation = (GLint)ranges.size();
+		ranges.push_back(range);
+		rangeUsed.push_back(true);
+	}
+
+	return allocation;
+}
+
+void GeometryArena::Free(GLint allocation)
+{
+	if (allocation < 0 || allocation >= (GLint)ranges.size() || !rangeUsed[allocation])
+		return;
+
+	Range& range = ranges[allocation];
+	FreeBlock(freeVertices, range.baseVertex, range.vertexCount);
+	FreeBlock(freeIndices, range.firstIndex, range.indexCount);
+
+	rangeUsed[allocation] = false;
+	freeIds.push_back(allocation);
+}
+
+void GeometryArena::Compact()
+{
+	if (VAO == 0)
+		return;
+
+	Rebuild(vertexCapacity, indexCapacity);
+}
+
+void GeometryArena::Bind()
+{
+	glBindVertexArray(VAO);
+}
+
+void GeometryArena::Unbind()
+{
+	glBindVertexArray(0);
+}
+
+void GeometryArena::Draw(GLint allocation)
+{
+	const Range& range = ranges[allocation];
+
+	//The indices of the mesh start from 0, baseVertex moves them to where the mesh vertices are stored
+	glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * range.firstIndex), range.baseVertex);
+}
+
+void GeometryArena::ClearArena()
+{
+	unsigned int liveAllocations = 0;
+	for (size_t i = 0; i < rangeUsed.size(); i++)
+	{
+		if (rangeUsed[i])
+			liveAllocations++;
+	}
+	if (liveAllocations > 0)
+		printf("Geometry arena cleared while %u meshes are still stored in it!\n", liveAllocations);
+
+	if (IBO != 0)
+	{
+		glDeleteBuffers(1, &IBO);
+		IBO = 0;
+	}
+
+	if (VBO != 0)
+	{
+		glDeleteBuffers(1, &VBO);
+		VBO = 0;
+	}
+
+	if (VAO != 0)
+	{
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+	}
+
+	vertexCapacity = 0;
+	indexCapacity = 0;
+
+	ranges.clear();
+	rangeUsed.clear();
+	freeIds.clear();
+	freeVertices.clear();
+	freeIndices.clear();
+}
+
+GeometryArena::~GeometryArena()
+{
+	ClearArena();
+}
+
+GLint GeometryArena::AllocateBlock(std::vector<Block>& freeList, GLsizei size)
+{
+	//First fit, the first free block that is big enough gets used
+	for (size_t i = 0; i < freeList.size(); i++)
+	{
+		if (freeList[i].size < size)
+			continue;
+
+		GLint offset = freeList[i].offset;
+		freeList[i].offset += size;
+		freeList[i].size -= size;
+
+		if (freeList[i].size == 0)
+			freeList.erase(freeList.begin() + i);
+
+		return offset;
+	}
+
+	return -1;
+}
+
+void GeometryArena::FreeBlock(std::vector<Block>& freeList, GLsizei offset, GLsizei size)
+{
+	//Finding where the block goes to keep the list sorted
+	size_t i = 0;
+	while (i < freeList.size() && freeList[i].offset < offset)
+		i++;
+
+	Block block = { offset, size };
+	freeList.insert(freeList.begin() + i, block);
+
+	//Merging with the next block if they touch
+	if (i + 1 < freeList.size() && freeList[i].offset + freeList[i].size == freeList[i + 1].offset)
+	{
+		freeList[i].size += freeList[i + 1].size;
+		freeList.erase(freeList.begin() + i + 1);
+	}
+
+	//Merging with the previous block if they touch
+	if (i > 0 && freeList[i - 1].offset + freeList[i - 1].size == freeList[i].offset)
+	{
+		freeList[i - 1].size += freeList[i].size;
+		freeList.erase(freeList.begin() + i);
+	}
+}
+
+void GeometryArena::Rebuild(GLsizei newVertexCapacity, GLsizei newIndexCapacity)
+{
+	//Copying inside the same buffer with overlapping ranges is not allowed, so live data goes to new buffers
+	GLuint newVBO = 0, newIBO = 0;
+
+	glGenBuffers(1, &newVBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLfloat) * VERTEX_SIZE * newVertexCapacity, NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &newIBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newIBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * newIndexCapacity, NULL, GL_STATIC_DRAW);
+
+	//Live allocations keep their order, so meshes that were close together stay close together
+	std::vector<GLint> live;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (rangeUsed[i])
+			live.push_back((GLint)i);
+	}
+
+	GLsizei vertexEnd = 0;
+	std::sort(live.begin(), live.end(), [this](GLint a, GLint b) { return ranges[a].baseVertex < ranges[b].baseVertex; });
+
+	glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		Range& range = ranges[live[i]];
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			sizeof(GLfloat) * VERTEX_SIZE * range.baseVertex, sizeof(GLfloat) * VERTEX_SIZE * vertexEnd, sizeof(GLfloat) * VERTEX_SIZE * range.vertexCount);
+		range.baseVertex = vertexEnd;
+		vertexEnd += range.vertexCount;
+	}
+
+	GLsizei indexEnd = 0;
+	std::sort(live.begin(), live.end(), [this](GLint a, GLint b) { return ranges[a].firstIndex < ranges[b].firstIndex; });
+
+	glBindBuffer(GL_COPY_READ_BUFFER, IBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newIBO);
+	for (size_t i = 0; i < live.size(); i++)
+	{
+		Range& range = ranges[live[i]];
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			sizeof(GLuint) * range.firstIndex, sizeof(GLuint) * indexEnd, sizeof(GLuint) * range.indexCount);
+		range.firstIndex = indexEnd;
+		indexEnd += range.indexCount;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (VBO != 0)
+		glDeleteBuffers(1, &VBO);
+	if (IBO != 0)
+		glDeleteBuffers(1, &IBO);
+
+	VBO = newVBO;
+	IBO = newIBO;
+	vertexCapacity = newVertexCapacity;
+	indexCapacity = newIndexCapacity;
+
+	//All the free space is now one block at the end of each buffer
+	freeVertices.clear();
+	freeIndices.clear();
+	if (vertexEnd < vertexCapacity)
+	{
+		Block block = { vertexEnd, vertexCapacity - vertexEnd };
+		freeVertices.push_back(block);
+	}
+	if (indexEnd < indexCapacity)
+	{
+		Block block = { indexEnd, indexCapacity - indexEnd };
+		freeIndices.push_back(block);
+	}
+
+	SetupVertexArray();
+}
+
+void GeometryArena::SetupVertexArray()
+{
+	//The VAO has to point at the new buffers every time they are replaced
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glVertexAttribPointer(0, VERTEX_SIZE, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(0);
+}
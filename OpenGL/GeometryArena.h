@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+/*
+Shared storage for the geometry of many meshes.
+Instead of every mesh owning its own VAO, VBO and IBO, the arena owns one of each and hands out ranges of them.
+Indices are stored relative to the start of their mesh, so a range is drawn with glDrawElementsBaseVertex
+and no index has to be rewritten when the ranges are moved around.
+
+Vertices use the same format as Mesh: 3 floats (x, y, z) per vertex in attribute 0.
+*/
+class GeometryArena
+{
+public:
+	//Where a mesh lives inside the arena
+	struct Range
+	{
+		GLint baseVertex;		//first vertex of the mesh in the vertex buffer
+		GLuint firstIndex;		//first index of the mesh in the index buffer
+		GLsizei vertexCount;
+		GLsizei indexCount;
+	};
+
+	GeometryArena();
+
+	/**
+	* Creates the shared buffers on the GPU.
+	*
+	* @param vertexCapacity How many vertices fit in the arena before it has to grow
+	* @param indexCapacity How many indices fit in the arena before it has to grow
+	*/
+	void CreateArena(GLsizei vertexCapacity, GLsizei indexCapacity);
+
+	/**
+	* Copies a mesh into the arena, reusing freed space when possible.
+	* When there is no free block big enough the arena is compacted, and grown if that is still not enough.
+	*
+	* @param numOfVertices The number of floats inside vertices (3 per vertex), the same as Mesh::CreateMesh
+	* @param numOfIndices The number of indices inside the mesh
+	* @return Id of the allocation, used to draw and free it. -1 if the mesh could not be stored
+	*/
+	GLint Allocate(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices);
+
+	/**
+	* Gives the space of an allocation back to the arena, the data stays on the GPU until it is overwritten.
+	*/
+	void Free(GLint allocation);
+
+	/**
+	* Moves every live allocation to the start of the buffers, merging all the free space into one block at the end.
+	* Ids stay valid, only the ranges they point to change.
+	*/
+	void Compact();
+
+	/**
+	* Binds the shared VAO. Every Draw between Bind and Unbind reuses it, without any buffer switch.
+	*/
+	void Bind();
+	void Unbind();
+
+	/**
+	* Draws one allocation, the arena has to be bound.
+	*/
+	void Draw(GLint allocation);
+
+	Range GetRange(GLint allocation) { return ranges[allocation]; }
+
+	GLuint GetVAO() { return VAO; }
+	GLuint GetVBO() { return VBO; }
+	GLuint GetIBO() { return IBO; }
+
+	/**
+	Clear all buffers from the GPU and forgets every allocation.
+	It does NOT destroy the class GeometryArena.
+	Meshes stored in the arena point to it, they have to be cleared before the arena is (see Mesh::CreateMesh).
+	*/
+	void ClearArena();
+
+	~GeometryArena();
+
+	//Floats per vertex, the same layout Mesh uses
+	static const GLsizei VERTEX_SIZE = 3;
+
+private:
+	//Unused part of a buffer, offset and size are counted in vertices or indices
+	struct Block
+	{
+		GLsizei offset;
+		GLsizei size;
+	};
+
+	GLuint VAO, VBO, IBO;
+	GLsizei vertexCapacity, indexCapacity;
+
+	std::vector<Range> ranges;
+	std::vector<bool> rangeUsed;
+	std::vector<GLint> freeIds;
+
+	//Kept sorted by offset, so neighbouring blocks can be merged back together
+	std::vector<Block> freeVertices;
+	std::vector<Block> freeIndices;
+
+	static GLint AllocateBlock(std::vector<Block>& freeList, GLsizei size);
+	static void FreeBlock(std::vector<Block>& freeList, GLsizei offset, GLsizei size);
+
+	void Rebuild(GLsizei newVertexCapacity, GLsizei newIndexCapacity);
+	void SetupVertexArray();
+};
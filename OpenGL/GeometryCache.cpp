@@ -0,0 +1,90 @@
+#include "GeometryCache.h"
+
+#include <string.h>
+
+std::unordered_map<unsigned long long, GeometryCache::Entry> GeometryCache::entries;
+GeometryCache::Stats GeometryCache::stats = { 0, 0, 0, 0 };
+
+unsigned long long GeometryCache::Hash(const void* data, size_t size, unsigned long long seed)
+{
+	//FNV-1a, but eating 8 bytes per step instead of 1 to keep up with large meshes
+	const unsigned long long prime = 1099511628211ULL;
+	unsigned long long hash = seed ^ 14695981039346656037ULL;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	for (; i < size; i++)
+		hash = (hash ^ bytes[i]) * prime;
+
+	//Mixing the size in, so data with a zeroed tail does not collide with the shorter data
+	hash = (hash ^ (unsigned long long)size) * prime;
+	return hash ^ (hash >> 32);
+}
+
+GeometryCache::Entry* GeometryCache::Acquire(unsigned long long hash, const std::vector<unsigned char>& data)
+{
+	std::unordered_map<unsigned long long, Entry>::iterator it = entries.find(hash);
+	if (it == entries.end())
+		return nullptr;
+
+	//Same hash, different geometry: the mesh gets its own buffers
+	if (it->second.data != data)
+		return nullptr;
+
+	it->second.refCount++;
+
+	stats.sharedMeshes++;
+	stats.bytesSaved += it->second.bytes;
+
+	return &it->second;
+}
+
+bool GeometryCache::Insert(unsigned long long hash, std::vector<unsigned char>& data, GLuint VAO, GLuint VBO, GLuint IBO, GLsizeiptr bytes)
+{
+	if (entries.find(hash) != entries.end())
+	{
+		printf("Geometry hash collision, the mesh will not be shared!\n");
+		return false;
+	}
+
+	Entry& entry = entries[hash];
+	entry.VAO = VAO;
+	entry.VBO = VBO;
+	entry.IBO = IBO;
+	entry.refCount = 1;
+	entry.bytes = bytes;
+	entry.data.swap(data);
+
+	stats.uniqueMeshes++;
+	stats.bytesUploaded += bytes;
+	return true;
+}
+
+bool GeometryCache::Release(unsigned long long hash)
+{
+	std::unordered_map<unsigned long long, Entry>::iterator it = entries.find(hash);
+	if (it == entries.end())
+		return false;
+
+	it->second.refCount--;
+	if (it->second.refCount > 0)
+		return false;
+
+	entries.erase(it);
+	return true;
+}
+
+void GeometryCache::PrintStats()
+{
+	printf("Geometry cache: %u unique meshes (%lld bytes uploaded), %u shared meshes (%lld bytes saved)\n",
+		stats.uniqueMeshes, (long long)stats.bytesUploaded, stats.sharedMeshes, (long long)stats.bytesSaved);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+#include <GL\glew.h>
+
+/*
+Registry of the GPU buffers created by meshes that asked to share their geometry.
+Meshes with the same vertex and index data get the same VAO, VBO and IBO, which are only deleted
+once the last mesh using them is cleared.
+
+Geometry is looked up by a 64 bit hash of its data. Each entry also keeps a copy of the data on the CPU,
+so a hash collision is caught by comparing the bytes and never gives a mesh the buffers of another one.
+The copy costs the memory of each unique geometry once, only for meshes created with SHARE_GEOMETRY.
+*/
+class GeometryCache
+{
+public:
+	struct Entry
+	{
+		GLuint VAO, VBO, IBO;
+		unsigned int refCount;
+		GLsizeiptr bytes;		//size of the vertex and index data, counted once per mesh sharing it
+		std::vector<unsigned char> data;	//what was hashed, compared on every lookup
+	};
+
+	struct Stats
+	{
+		unsigned int uniqueMeshes;		//geometries that were actually uploaded
+		unsigned int sharedMeshes;		//meshes that reused an existing geometry
+		GLsizeiptr bytesUploaded;
+		GLsizeiptr bytesSaved;
+	};
+
+	/**
+	* Hashes a block of memory.
+	*
+	* @param seed Hash of the previous block, to chain several blocks into one hash
+	*/
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long seed);
+
+	/**
+	* Looks for an existing geometry and takes a reference to it.
+	*
+	* @param data The bytes the hash was computed from
+	* @return The shared buffers, or nullptr when this geometry has not been uploaded yet or another one has the same hash
+	*/
+	static Entry* Acquire(unsigned long long hash, const std::vector<unsigned char>& data);
+
+	/**
+	* Registers buffers that have just been uploaded, with a reference count of 1.
+	*
+	* @param data The bytes the hash was computed from, moved into the entry
+	* @return false when another geometry already has this hash, the buffers are then not shared
+	*/
+	static bool Insert(unsigned long long hash, std::vector<unsigned char>& data, GLuint VAO, GLuint VBO, GLuint IBO, GLsizeiptr bytes);
+
+	/**
+	* Drops one reference to a geometry.
+	* @return true when it was the last reference, and the caller has to delete the buffers
+	*/
+	static bool Release(unsigned long long hash);
+
+	static Stats GetStats() { return stats; }
+
+	static void PrintStats();
+
+private:
+	static std::unordered_map<unsigned long long, Entry> entries;
+	static Stats stats;
+};
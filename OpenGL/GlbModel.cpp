@@ -0,0 +1,487 @@
+#include "GlbModel.h"
+
+#include <string.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Json.h"
+
+namespace
+{
+	const unsigned int GLB_MAGIC = 0x46546C67;		//"glTF"
+	const unsigned int JSON_CHUNK = 0x4E4F534A;		//"JSON"
+	const unsigned int BIN_CHUNK = 0x004E4942;		//"BIN\0"
+
+	//Where an accessor reads its elements inside the binary chunk
+	struct AccessorData
+	{
+		const unsigned char* data;
+		size_t bufferView;
+		size_t byteOffset;		//from the start of the buffer view
+		GLsizei stride;
+		GLsizei elementSize;
+		GLint components;
+		GLenum componentType;
+		GLboolean normalized;
+		unsigned int count;
+	};
+
+	unsigned int ReadUint(const unsigned char* bytes)
+	{
+		//glb files are little endian, like every platform this runs on
+		unsigned int value;
+		memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	GLint GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	GLsizei GetComponentSize(GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	bool ReadAccessor(const JsonValue& json, size_t accessor, const unsigned char* bin, size_t binSize, AccessorData& result)
+	{
+		const JsonValue& description = json["accessors"][accessor];
+		if (description.HasMember("sparse"))
+		{
+			printf("Sparse glTF accessors are not supported!\n");
+			return false;
+		}
+
+		double bufferViewIndex = description["bufferView"].GetNumber(-1.0);
+		const JsonValue& bufferView = json["bufferViews"][(size_t)(bufferViewIndex < 0.0 ? 0.0 : bufferViewIndex)];
+		if (bufferViewIndex < 0.0 || bufferView.IsNull())
+		{
+			printf("glTF accessor without data!\n");
+			return false;
+		}
+
+		if (bufferView["buffer"].GetNumber(0.0) != 0.0 || bin == nullptr)
+		{
+			printf("Only the binary chunk of the glb file can hold data, external buffers are not supported!\n");
+			return false;
+		}
+
+		result.bufferView = (size_t)bufferViewIndex;
+		result.byteOffset = (size_t)description["byteOffset"].GetNumber(0.0);
+		result.components = GetComponentCount(description["type"].GetString());
+		result.componentType = (GLenum)description["componentType"].GetNumber(0.0);
+		result.normalized = description["normalized"].GetBoolean(false) ? GL_TRUE : GL_FALSE;
+		result.count = (unsigned int)description["count"].GetNumber(0.0);
+		result.elementSize = result.components * GetComponentSize(result.componentType);
+		result.stride = (GLsizei)bufferView["byteStride"].GetNumber(0.0);
+		if (result.stride == 0)
+			result.stride = result.elementSize;
+
+		size_t viewOffset = (size_t)bufferView["byteOffset"].GetNumber(0.0);
+		size_t viewLength = (size_t)bufferView["byteLength"].GetNumber(0.0);
+
+		if (result.elementSize == 0 || result.count == 0 || viewOffset + viewLength > binSize ||
+			result.byteOffset + (size_t)(result.count - 1) * result.stride + result.elementSize > viewLength)
+		{
+			printf("glTF accessor %zu is invalid!\n", accessor);
+			return false;
+		}
+
+		result.data = bin + viewOffset + result.byteOffset;
+		return true;
+	}
+
+	glm::mat4 ReadTransform(const JsonValue& node)
+	{
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.GetSize() == 16)
+		{
+			//Column major, like glm
+			glm::mat4 transform;
+			for (int column = 0; column < 4; column++)
+				for (int row = 0; row < 4; row++)
+					transform[column][row] = (float)matrix[column * 4 + row].GetNumber();
+			return transform;
+		}
+
+		const JsonValue& t = node["translation"];
+		const JsonValue& r = node["rotation"];
+		const JsonValue& s = node["scale"];
+
+		glm::vec3 translation((float)t[(size_t)0].GetNumber(0.0), (float)t[1].GetNumber(0.0), (float)t[2].GetNumber(0.0));
+		//glTF stores x, y, z, w and glm takes w first
+		glm::quat rotation((float)r[3].GetNumber(1.0), (float)r[(size_t)0].GetNumber(0.0), (float)r[1].GetNumber(0.0), (float)r[2].GetNumber(0.0));
+		glm::vec3 scale((float)s[(size_t)0].GetNumber(1.0), (float)s[1].GetNumber(1.0), (float)s[2].GetNumber(1.0));
+
+		return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+	}
+}
+
+GlbModel::GlbModel()
+{
+	meshPrimitives.push_back(0);
+}
+
+bool GlbModel::Load(const char* path)
+{
+	ClearModel();
+
+	if (!file.Open(path))
+		return false;
+
+	if (!Parse(file.GetData(), file.GetSize()))
+	{
+		printf("Failed to read %s!\n", path);
+		ClearModel();
+		return false;
+	}
+
+	return true;
+}
+
+bool GlbModel::Parse(const unsigned char* glb, size_t size)
+{
+	primitives.clear();
+	meshPrimitives.assign(1, 0);
+	nodes.clear();
+	skins.clear();
+	ownedData.clear();
+
+	if (size < 20 || ReadUint(glb) != GLB_MAGIC || ReadUint(glb + 4) != 2)
+	{
+		printf("Not a glTF 2.0 binary file!\n");
+		return false;
+	}
+
+	size_t jsonLength = ReadUint(glb + 12);
+	if (ReadUint(glb + 16) != JSON_CHUNK || 20 + jsonLength > size)
+	{
+		printf("glb file without its JSON chunk!\n");
+		return false;
+	}
+
+	JsonValue json;
+	if (!JsonValue::Parse((const char*)glb + 20, jsonLength, json))
+	{
+		printf("glb file with invalid JSON!\n");
+		return false;
+	}
+
+	//The binary chunk is optional, it follows the JSON one (padded to 4 bytes)
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+	size_t binHeader = 20 + ((jsonLength + 3) & ~(size_t)3);
+	if (binHeader + 8 <= size && ReadUint(glb + binHeader + 4) == BIN_CHUNK)
+	{
+		binSize = ReadUint(glb + binHeader);
+		bin = glb + binHeader + 8;
+		if (binHeader + 8 + binSize > size)
+		{
+			printf("glb binary chunk is cut short!\n");
+			return false;
+		}
+	}
+
+	struct Semantic
+	{
+		const char* name;
+		GLuint location;
+		bool integer;
+	};
+	static const Semantic semantics[] = {
+		{ "POSITION", VertexLayout::POSITION_LOCATION, false },
+		{ "NORMAL", VertexLayout::NORMAL_LOCATION, false },
+		{ "TEXCOORD_0", VertexLayout::UV_LOCATION, false },
+		{ "COLOR_0", VertexLayout::COLOUR_LOCATION, false },
+		{ "TANGENT", TANGENT_LOCATION, false },
+		{ "JOINTS_0", JOINTS_LOCATION, true },
+		{ "WEIGHTS_0", WEIGHTS_LOCATION, false }
+	};
+
+	const JsonValue& meshes = json["meshes"];
+	for (size_t m = 0; m < meshes.GetSize(); m++)
+	{
+		const JsonValue& jsonPrimitives = meshes[m]["primitives"];
+		for (size_t p = 0; p < jsonPrimitives.GetSize(); p++)
+		{
+			const JsonValue& jsonPrimitive = jsonPrimitives[p];
+			if (jsonPrimitive["mode"].GetNumber(4.0) != 4.0)
+			{
+				printf("glTF primitive %zu of mesh %zu is not made of triangles, it is skipped!\n", p, m);
+				continue;
+			}
+
+			const JsonValue& attributes = jsonPrimitive["attributes"];
+			if (!attributes.HasMember("POSITION"))
+			{
+				printf("glTF primitive %zu of mesh %zu has no positions, it is skipped!\n", p, m);
+				continue;
+			}
+
+			Primitive primitive;
+			primitive.numOfVertices = 0;
+
+			//Attributes in the same vertex of the same buffer view are interleaved, they share one stream
+			std::vector<size_t> streamViews;
+			std::vector<const unsigned char*> streamStarts;
+			std::vector<GLsizei> streamStrides;
+			bool valid = true;
+
+			for (size_t s = 0; s < sizeof(semantics) / sizeof(semantics[0]) && valid; s++)
+			{
+				if (!attributes.HasMember(semantics[s].name))
+					continue;
+
+				AccessorData accessor;
+				if (!ReadAccessor(json, (size_t)attributes[semantics[s].name].GetNumber(), bin, binSize, accessor))
+				{
+					valid = false;
+					break;
+				}
+
+				if (primitive.numOfVertices == 0)
+					primitive.numOfVertices = accessor.count;
+				valid = accessor.count == primitive.numOfVertices;
+
+				const unsigned char* vertexStart = accessor.data - accessor.byteOffset % accessor.stride;
+				GLuint stream = 0;
+				while (stream < streamStarts.size() && !(streamViews[stream] == accessor.bufferView && streamStarts[stream] == vertexStart && streamStrides[stream] == accessor.stride))
+					stream++;
+
+				if (stream == streamStarts.size())
+				{
+					streamViews.push_back(accessor.bufferView);
+					streamStarts.push_back(vertexStart);
+					streamStrides.push_back(accessor.stride);
+				}
+
+				primitive.layout.AddAttributeAt(semantics[s].location, accessor.components, accessor.componentType, accessor.normalized,
+					semantics[s].integer, accessor.elementSize, stream, (GLsizei)(accessor.data - vertexStart));
+			}
+
+			if (!valid)
+			{
+				printf("glTF primitive %zu of mesh %zu has invalid attributes, it is skipped!\n", p, m);
+				continue;
+			}
+
+			for (GLuint stream = 0; stream < streamStarts.size(); stream++)
+			{
+				primitive.layout.SetStride(stream, streamStrides[stream]);
+
+				//The last vertex does not always have the padding of the stride, reading a full stride
+				//could go past the end of the file, so that stream is copied instead
+				size_t streamSize = (size_t)primitive.layout.GetStreamSize(stream, primitive.numOfVertices);
+				if (streamStarts[stream] + streamSize <= bin + binSize)
+				{
+					primitive.streams.push_back(streamStarts[stream]);
+				}
+				else
+				{
+					ownedData.push_back(std::vector<unsigned char>(streamSize, 0));
+					memcpy(ownedData.back().data(), streamStarts[stream], bin + binSize - streamStarts[stream]);
+					primitive.streams.push_back(ownedData.back().data());
+				}
+			}
+
+			if (jsonPrimitive.HasMember("indices"))
+			{
+				AccessorData accessor;
+				if (!ReadAccessor(json, (size_t)jsonPrimitive["indices"].GetNumber(), bin, binSize, accessor) ||
+					accessor.components != 1 || accessor.stride != accessor.elementSize ||
+					(accessor.componentType != GL_UNSIGNED_BYTE && accessor.componentType != GL_UNSIGNED_SHORT && accessor.componentType != GL_UNSIGNED_INT))
+				{
+					printf("glTF primitive %zu of mesh %zu has invalid indices, it is skipped!\n", p, m);
+					continue;
+				}
+
+				//The indices go to the GPU and the CPU passes as they are, one past the vertices would read or write out of bounds
+				if (!IndexFormat::CheckTriangles(accessor.data, accessor.componentType, accessor.count, primitive.numOfVertices))
+				{
+					printf("glTF primitive %zu of mesh %zu has indices outside of its vertices or not whole triangles, it is skipped!\n", p, m);
+					continue;
+				}
+
+				primitive.indices = accessor.data;
+				primitive.indexType = accessor.componentType;
+				primitive.numOfIndices = accessor.count;
+			}
+			else if (primitive.numOfVertices % 3 != 0)
+			{
+				printf("glTF primitive %zu of mesh %zu is not whole triangles, it is skipped!\n", p, m);
+				continue;
+			}
+			else
+			{
+				//Every vertex drawn once, in order
+				std::vector<unsigned int> sequence(primitive.numOfVertices);
+				for (unsigned int i = 0; i < primitive.numOfVertices; i++)
+					sequence[i] = i;
+
+				GLenum type = IndexFormat::ChooseType(sequence.data(), sequence.size(), false);
+				ownedData.push_back(std::vector<unsigned char>(IndexFormat::GetSize(type) * sequence.size()));
+				IndexFormat::Narrow(sequence.data(), sequence.size(), type, ownedData.back().data());
+
+				primitive.indices = ownedData.back().data();
+				primitive.indexType = type;
+				primitive.numOfIndices = primitive.numOfVertices;
+			}
+
+			primitives.push_back(primitive);
+		}
+
+		meshPrimitives.push_back(primitives.size());
+	}
+
+	//Nodes, then their parents, then the world transforms from the roots down
+	const JsonValue& jsonNodes = json["nodes"];
+	nodes.resize(jsonNodes.GetSize());
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i].mesh = (int)jsonNodes[i]["mesh"].GetNumber(-1.0);
+		if (nodes[i].mesh >= (int)GetMeshCount())
+			nodes[i].mesh = -1;
+		nodes[i].parent = -1;
+		nodes[i].skin = (int)jsonNodes[i]["skin"].GetNumber(-1.0);
+		nodes[i].localTransform = ReadTransform(jsonNodes[i]);
+		nodes[i].worldTransform = nodes[i].localTransform;
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		const JsonValue& children = jsonNodes[i]["children"];
+		for (size_t c = 0; c < children.GetSize(); c++)
+		{
+			size_t child = (size_t)children[c].GetNumber(-1.0);
+			if (child < nodes.size() && child != i)
+				nodes[child].parent = (int)i;
+		}
+	}
+
+	std::vector<size_t> stack;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].parent < 0)
+			stack.push_back(i);
+	}
+
+	while (!stack.empty())
+	{
+		size_t parent = stack.back();
+		stack.pop_back();
+
+		const JsonValue& children = jsonNodes[parent]["children"];
+		for (size_t c = 0; c < children.GetSize(); c++)
+		{
+			size_t child = (size_t)children[c].GetNumber(-1.0);
+			if (child >= nodes.size() || nodes[child].parent != (int)parent)
+				continue;
+
+			nodes[child].worldTransform = nodes[parent].worldTransform * nodes[child].localTransform;
+			stack.push_back(child);
+		}
+	}
+
+	//Skins: the joint nodes and the matrices taking the mesh to each joint in the bind pose
+	const JsonValue& jsonSkins = json["skins"];
+	skins.resize(jsonSkins.GetSize());
+	for (size_t i = 0; i < skins.size(); i++)
+	{
+		const JsonValue& joints = jsonSkins[i]["joints"];
+		skins[i].joints.resize(joints.GetSize());
+		for (size_t j = 0; j < joints.GetSize(); j++)
+		{
+			skins[i].joints[j] = (int)joints[j].GetNumber(-1.0);
+			if (skins[i].joints[j] < 0 || skins[i].joints[j] >= (int)nodes.size())
+			{
+				printf("glTF skin %zu has an invalid joint!\n", i);
+				return false;
+			}
+		}
+
+		//Without the matrices every joint starts at the origin of the mesh
+		skins[i].inverseBindMatrices.assign(joints.GetSize(), glm::mat4(1.0f));
+		if (jsonSkins[i].HasMember("inverseBindMatrices"))
+		{
+			AccessorData accessor;
+			if (!ReadAccessor(json, (size_t)jsonSkins[i]["inverseBindMatrices"].GetNumber(), bin, binSize, accessor) ||
+				accessor.components != 16 || accessor.componentType != GL_FLOAT || accessor.count < joints.GetSize())
+			{
+				printf("glTF skin %zu has invalid inverse bind matrices!\n", i);
+				return false;
+			}
+
+			for (size_t j = 0; j < joints.GetSize(); j++)
+				memcpy(&skins[i].inverseBindMatrices[j], accessor.data + j * accessor.stride, sizeof(glm::mat4));
+		}
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].skin >= (int)skins.size())
+			nodes[i].skin = -1;
+	}
+
+	return true;
+}
+
+void GlbModel::ComputeSkinMatrices(size_t skin, const glm::mat4* jointWorldTransforms, glm::mat4* skinMatrices)
+{
+	const Skin& joints = skins[skin];
+	for (size_t j = 0; j < joints.joints.size(); j++)
+	{
+		const glm::mat4& joint = jointWorldTransforms != nullptr ? jointWorldTransforms[j] : nodes[joints.joints[j]].worldTransform;
+		skinMatrices[j] = joint * joints.inverseBindMatrices[j];
+	}
+}
+
+void GlbModel::GetMeshData(size_t primitive, MeshData& data)
+{
+	const Primitive& source = primitives[primitive];
+
+	data = MeshData();
+	data.layout = source.layout;
+	data.numOfVertices = source.numOfVertices;
+	for (GLuint i = 0; i < source.layout.GetStreamCount(); i++)
+		data.SetStream(i, source.streams[i]);
+
+	data.indexType = source.indexType;
+	data.numOfIndices = source.numOfIndices;
+	data.indices.resize((size_t)IndexFormat::GetSize(source.indexType) * source.numOfIndices);
+	memcpy(data.indices.data(), source.indices, data.indices.size());
+}
+
+void GlbModel::ClearModel()
+{
+	primitives.clear();
+	meshPrimitives.assign(1, 0);
+	nodes.clear();
+	skins.clear();
+	ownedData.clear();
+	file.Close();
+}
+
+GlbModel::~GlbModel()
+{
+	ClearModel();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "MeshData.h"
+#include "VertexLayout.h"
+
+/*
+A glTF 2.0 binary file (.glb): its meshes, the nodes placing them in the scene and the skins animating them.
+
+The file is mapped into memory and the vertex and index data is never converted: every accessor keeps its
+component type (quantized normals stay bytes, 16 bit indices stay 16 bit) and its bytes go from the mapped
+binary chunk straight into the GL buffers. Attributes interleaved in one buffer view share one stream.
+
+Attributes are read from these locations:
+	POSITION 0, NORMAL 1, TEXCOORD_0 2, COLOR_0 3, TANGENT 9, JOINTS_0 10 (as integers), WEIGHTS_0 11
+Only triangle primitives are read, sparse accessors and external buffers are not supported.
+*/
+class GlbModel
+{
+public:
+	//One draw of a glTF mesh: vertices and indices pointing inside the mapped file
+	struct Primitive
+	{
+		VertexLayout layout;
+		std::vector<const void*> streams;
+		unsigned int numOfVertices;
+
+		const void* indices;
+		GLenum indexType;
+		unsigned int numOfIndices;
+	};
+
+	struct Node
+	{
+		int mesh;					//-1 when the node only moves its children
+		int parent;					//-1 for the roots
+		int skin;					//-1 when the mesh of the node is not skinned
+		glm::mat4 localTransform;
+		glm::mat4 worldTransform;	//localTransform of every parent applied
+	};
+
+	//Joints moving the vertices of skinned meshes, see BonePalette
+	struct Skin
+	{
+		std::vector<int> joints;						//node of each joint, JOINTS_0 indexes this list
+		std::vector<glm::mat4> inverseBindMatrices;		//from the mesh to each joint in the bind pose
+	};
+
+	//Attribute locations of the glTF attributes the shaders may need beyond VertexLayout's
+	static const GLuint TANGENT_LOCATION = VertexLayout::TANGENT_LOCATION;
+	static const GLuint JOINTS_LOCATION = VertexLayout::JOINTS_LOCATION;
+	static const GLuint WEIGHTS_LOCATION = VertexLayout::WEIGHTS_LOCATION;
+
+	GlbModel();
+
+	GlbModel(const GlbModel&) = delete;
+	GlbModel& operator=(const GlbModel&) = delete;
+
+	/**
+	* Maps and reads a .glb file. Does not need an OpenGL context.
+	*
+	* @return false when the file can not be read or is not a valid glTF 2.0 binary
+	*/
+	bool Load(const char* path);
+
+	/**
+	* Reads a .glb file already in memory, which has to stay there as long as the model is used.
+	*/
+	bool Parse(const unsigned char* glb, size_t size);
+
+	/**
+	* Copies a primitive into a MeshData, for the CPU passes or to store it in another format.
+	*/
+	void GetMeshData(size_t primitive, MeshData& data);
+
+	/*MeshPool::CreateFromGlb creates a Mesh for each of them*/
+	const std::vector<Primitive>& GetPrimitives() { return primitives; }
+	const std::vector<Node>& GetNodes() { return nodes; }
+	const std::vector<Skin>& GetSkins() { return skins; }
+
+	/**
+	* Computes the skin matrix of every joint of a skin (joint world transform * inverse bind matrix), ready for BonePalette.
+	* glTF skinned meshes ignore the transform of their own node: the matrices already place the vertices in the world,
+	* so the mesh is drawn with an identity model matrix.
+	*
+	* @param jointWorldTransforms The animated world transform of every joint, nullptr for the pose stored in the file
+	* @param skinMatrices Receives one matrix per joint
+	*/
+	void ComputeSkinMatrices(size_t skin, const glm::mat4* jointWorldTransforms, glm::mat4* skinMatrices);
+
+	/*The primitives of a glTF mesh are GetPrimitives()[GetFirstPrimitive(mesh)] onwards*/
+	size_t GetMeshCount() { return meshPrimitives.size() - 1; }
+	size_t GetFirstPrimitive(size_t mesh) { return meshPrimitives[mesh]; }
+	size_t GetPrimitiveCount(size_t mesh) { return meshPrimitives[mesh + 1] - meshPrimitives[mesh]; }
+
+	/**
+	Unmaps the file and forgets every primitive and node.
+	It does NOT destroy the class GlbModel.
+	*/
+	void ClearModel();
+
+	~GlbModel();
+
+private:
+	MappedFile file;
+	std::vector<Primitive> primitives;
+	std::vector<size_t> meshPrimitives;		//first primitive of each mesh, plus the total at the end
+	std::vector<Node> nodes;
+	std::vector<Skin> skins;
+
+	//Data that could not point inside the file (generated indices, streams ending past the binary chunk)
+	std::vector<std::vector<unsigned char> > ownedData;
+};
@@ -0,0 +1,78 @@
+#include "IndexFormat.h"
+
+#include <string.h>
+
+GLenum IndexFormat::ChooseType(const unsigned int* indices, size_t numOfIndices, bool allowBytes)
+{
+	unsigned int maxIndex = 0;
+	for (size_t i = 0; i < numOfIndices; i++)
+	{
+		if (indices[i] > maxIndex)
+			maxIndex = indices[i];
+	}
+
+	if (allowBytes && maxIndex <= 0xFF)
+		return GL_UNSIGNED_BYTE;
+
+	if (maxIndex <= 0xFFFF)
+		return GL_UNSIGNED_SHORT;
+
+	return GL_UNSIGNED_INT;
+}
+
+GLsizei IndexFormat::GetSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+void IndexFormat::Narrow(const unsigned int* indices, size_t numOfIndices, GLenum type, void* destination)
+{
+	if (type == GL_UNSIGNED_BYTE)
+	{
+		GLubyte* narrow = (GLubyte*)destination;
+		for (size_t i = 0; i < numOfIndices; i++)
+			narrow[i] = (GLubyte)indices[i];
+	}
+	else if (type == GL_UNSIGNED_SHORT)
+	{
+		GLushort* narrow = (GLushort*)destination;
+		for (size_t i = 0; i < numOfIndices; i++)
+			narrow[i] = (GLushort)indices[i];
+	}
+	else
+	{
+		memcpy(destination, indices, sizeof(unsigned int) * numOfIndices);
+	}
+}
+
+unsigned int IndexFormat::Read(const void* indices, GLenum type, size_t i)
+{
+	if (type == GL_UNSIGNED_BYTE)
+		return ((const GLubyte*)indices)[i];
+
+	if (type == GL_UNSIGNED_SHORT)
+		return ((const GLushort*)indices)[i];
+
+	return ((const GLuint*)indices)[i];
+}
+
+bool IndexFormat::CheckTriangles(const void* indices, GLenum type, size_t numOfIndices, size_t numOfVertices)
+{
+	if (numOfIndices % 3 != 0)
+		return false;
+
+	for (size_t i = 0; i < numOfIndices; i++)
+	{
+		if (Read(indices, type, i) >= numOfVertices)
+			return false;
+	}
+	return true;
+}
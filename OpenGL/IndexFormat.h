@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL\glew.h>
+
+/*
+Helpers for index buffers stored as GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+*/
+namespace IndexFormat
+{
+	/**
+	* Finds the smallest index type able to hold every index.
+	*
+	* @param allowBytes Whether GL_UNSIGNED_BYTE may be chosen. Many desktop GPUs have no native support for it
+	* and the driver converts it on every draw, so it is only worth it where memory matters most
+	*/
+	GLenum ChooseType(const unsigned int* indices, size_t numOfIndices, bool allowBytes);
+
+	/**
+	* @return Bytes taken by one index of the type
+	*/
+	GLsizei GetSize(GLenum type);
+
+	/**
+	* Copies indices into destination, stored as type. Every index has to fit in the type.
+	*/
+	void Narrow(const unsigned int* indices, size_t numOfIndices, GLenum type, void* destination);
+
+	/**
+	* Reads one index stored as type.
+	*/
+	unsigned int Read(const void* indices, GLenum type, size_t i);
+
+	/**
+	* Checks indices drawn as GL_TRIANGLES: whole triangles only and every index inside the vertices.
+	* Indices read from a file have to pass before anything indexes vertex arrays with them.
+	*/
+	bool CheckTriangles(const void* indices, GLenum type, size_t numOfIndices, size_t numOfVertices);
+}
@@ -0,0 +1,319 @@
+#include "Json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	const JsonValue nullValue;
+
+	//Documents nested deeper than this are rejected instead of overflowing the stack
+	const int MAX_DEPTH = 256;
+}
+
+/*
+Recursive descent over the text, one function per kind of value.
+*/
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t size) : c(text), end(text + size) {}
+
+	bool ParseDocument(JsonValue& root)
+	{
+		if (!ParseValue(root, 0))
+			return false;
+
+		SkipSpaces();
+		return c == end;
+	}
+
+private:
+	const char* c;
+	const char* end;
+
+	void SkipSpaces()
+	{
+		while (c < end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r'))
+			c++;
+	}
+
+	bool Match(const char* word)
+	{
+		size_t length = strlen(word);
+		if ((size_t)(end - c) < length || strncmp(c, word, length) != 0)
+			return false;
+
+		c += length;
+		return true;
+	}
+
+	bool ParseValue(JsonValue& value, int depth)
+	{
+		SkipSpaces();
+		if (c >= end || depth > MAX_DEPTH)
+			return false;
+
+		switch (*c)
+		{
+		case '{':
+			return ParseObject(value, depth);
+		case '[':
+			return ParseArray(value, depth);
+		case '"':
+			value.type = JsonValue::STRING;
+			return ParseString(value.string);
+		case 't':
+			value.type = JsonValue::BOOLEAN;
+			value.boolean = true;
+			return Match("true");
+		case 'f':
+			value.type = JsonValue::BOOLEAN;
+			value.boolean = false;
+			return Match("false");
+		case 'n':
+			value.type = JsonValue::NULL_VALUE;
+			return Match("null");
+		default:
+			return ParseNumber(value);
+		}
+	}
+
+	bool ParseNumber(JsonValue& value)
+	{
+		//strtod needs a terminated string, numbers are short so they are copied first
+		char buffer[64];
+		size_t length = 0;
+		while (c + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", c[length]) != nullptr)
+			length++;
+
+		if (length == 0)
+			return false;
+
+		memcpy(buffer, c, length);
+		buffer[length] = '\0';
+
+		char* numberEnd = nullptr;
+		value.type = JsonValue::NUMBER;
+		value.number = strtod(buffer, &numberEnd);
+		c += length;
+		return numberEnd == buffer + length;
+	}
+
+	void AppendUtf8(std::string& string, unsigned int code)
+	{
+		if (code < 0x80)
+		{
+			string += (char)code;
+		}
+		else if (code < 0x800)
+		{
+			string += (char)(0xC0 | (code >> 6));
+			string += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			string += (char)(0xE0 | (code >> 12));
+			string += (char)(0x80 | ((code >> 6) & 0x3F));
+			string += (char)(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			string += (char)(0xF0 | (code >> 18));
+			string += (char)(0x80 | ((code >> 12) & 0x3F));
+			string += (char)(0x80 | ((code >> 6) & 0x3F));
+			string += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool ParseHex(unsigned int& code)
+	{
+		if (end - c < 4)
+			return false;
+
+		code = 0;
+		for (int i = 0; i < 4; i++, c++)
+		{
+			code <<= 4;
+			if (*c >= '0' && *c <= '9')
+				code |= *c - '0';
+			else if (*c >= 'a' && *c <= 'f')
+				code |= *c - 'a' + 10;
+			else if (*c >= 'A' && *c <= 'F')
+				code |= *c - 'A' + 10;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	bool ParseString(std::string& string)
+	{
+		c++;
+		while (c < end && *c != '"')
+		{
+			if (*c != '\\')
+			{
+				string += *c++;
+				continue;
+			}
+
+			c++;
+			if (c >= end)
+				return false;
+
+			char escaped = *c++;
+			switch (escaped)
+			{
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u':
+			{
+				unsigned int code;
+				if (!ParseHex(code))
+					return false;
+
+				//A surrogate pair is one character written as two
+				if (code >= 0xD800 && code < 0xDC00 && end - c >= 2 && c[0] == '\\' && c[1] == 'u')
+				{
+					c += 2;
+					unsigned int low;
+					if (!ParseHex(low))
+						return false;
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+
+				AppendUtf8(string, code);
+				break;
+			}
+			default:
+				string += escaped;
+				break;
+			}
+		}
+
+		if (c >= end)
+			return false;
+
+		c++;
+		return true;
+	}
+
+	bool ParseArray(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::ARRAY;
+		c++;
+
+		SkipSpaces();
+		if (c < end && *c == ']')
+		{
+			c++;
+			return true;
+		}
+
+		for (;;)
+		{
+			value.elements.push_back(JsonValue());
+			if (!ParseValue(value.elements.back(), depth + 1))
+				return false;
+
+			SkipSpaces();
+			if (c < end && *c == ',')
+			{
+				c++;
+				continue;
+			}
+			if (c < end && *c == ']')
+			{
+				c++;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	bool ParseObject(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::OBJECT;
+		c++;
+
+		SkipSpaces();
+		if (c < end && *c == '}')
+		{
+			c++;
+			return true;
+		}
+
+		for (;;)
+		{
+			SkipSpaces();
+			if (c >= end || *c != '"')
+				return false;
+
+			value.members.push_back(std::make_pair(std::string(), JsonValue()));
+			if (!ParseString(value.members.back().first))
+				return false;
+
+			SkipSpaces();
+			if (c >= end || *c != ':')
+				return false;
+			c++;
+
+			if (!ParseValue(value.members.back().second, depth + 1))
+				return false;
+
+			SkipSpaces();
+			if (c < end && *c == ',')
+			{
+				c++;
+				continue;
+			}
+			if (c < end && *c == '}')
+			{
+				c++;
+				return true;
+			}
+			return false;
+		}
+	}
+};
+
+JsonValue::JsonValue()
+{
+	type = NULL_VALUE;
+	boolean = false;
+	number = 0.0;
+}
+
+bool JsonValue::Parse(const char* text, size_t size, JsonValue& root)
+{
+	root = JsonValue();
+
+	JsonParser parser(text, size);
+	return parser.ParseDocument(root);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	if (type != ARRAY || index >= elements.size())
+		return nullValue;
+
+	return elements[index];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	if (type != OBJECT)
+		return nullValue;
+
+	for (size_t i = 0; i < members.size(); i++)
+	{
+		if (members[i].first == key)
+			return members[i].second;
+	}
+
+	return nullValue;
+}
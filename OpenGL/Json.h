@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+A value read from a JSON document, just enough of JSON for the glTF files GlbModel reads.
+
+Looking up a key or index that does not exist gives a null value instead of failing, so nested lookups
+can be chained: json["nodes"][2]["mesh"].GetNumber(-1)
+*/
+class JsonValue
+{
+public:
+	enum Type
+	{
+		NULL_VALUE,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	JsonValue();
+
+	/**
+	* Parses a whole document into root.
+	*
+	* @return false when the text is not valid JSON
+	*/
+	static bool Parse(const char* text, size_t size, JsonValue& root);
+
+	Type GetType() const { return type; }
+	bool IsNull() const { return type == NULL_VALUE; }
+
+	double GetNumber(double fallback = 0.0) const { return type == NUMBER ? number : fallback; }
+	bool GetBoolean(bool fallback = false) const { return type == BOOLEAN ? boolean : fallback; }
+	const std::string& GetString() const { return string; }
+
+	/*Elements of an array or members of an object*/
+	size_t GetSize() const { return type == ARRAY ? elements.size() : members.size(); }
+
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](const char* key) const;
+
+	bool HasMember(const char* key) const { return !(*this)[key].IsNull(); }
+
+private:
+	Type type;
+	bool boolean;
+	double number;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::pair<std::string, JsonValue> > members;
+
+	friend class JsonParser;
+};
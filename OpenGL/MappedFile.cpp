@@ -0,0 +1,114 @@
+#include "MappedFile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	file = -1;
+#endif
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Failed to open %s!\n", path);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	//An empty file can not be mapped, it is just an empty range
+	if (size == 0)
+		return true;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != nullptr)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		printf("Failed to open %s!\n", path);
+		return false;
+	}
+
+	struct stat fileStat;
+	fstat(file, &fileStat);
+	size = (size_t)fileStat.st_size;
+
+	if (size == 0)
+		return true;
+
+	void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (view != MAP_FAILED)
+	{
+		data = (const unsigned char*)view;
+		//The file is read from start to end, the kernel can read ahead
+		madvise(view, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (data == nullptr)
+	{
+		printf("Failed to map %s!\n", path);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr)
+		munmap((void*)data, size);
+	if (file >= 0)
+		close(file);
+
+	file = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
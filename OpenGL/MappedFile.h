@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+A file mapped into memory, read only.
+The operating system pages the file in as it is read, nothing is copied into a buffer of our own.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	* Maps a whole file, closing the one mapped before.
+	*
+	* @return false when the file can not be opened or mapped
+	*/
+	bool Open(const char* path);
+
+	const unsigned char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+	/**
+	Unmaps the file and closes it.
+	It does NOT destroy the class MappedFile.
+	*/
+	void Close();
+
+	~MappedFile();
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* file;			//HANDLE
+	void* mapping;		//HANDLE
+#else
+	int file;
+#endif
+};
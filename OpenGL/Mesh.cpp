@@ -1,5 +1,11 @@
 #include "Mesh.h"
 
+#include <string.h>
+#include <utility>
+
+#include "CookedMesh.h"
+#include "MappedFile.h"
+
 
 Mesh::Mesh()
 {
@@ -8,12 +14,275 @@ Mesh::Mesh()
 	VBO = 0;
 	IBO = 0;
 	indexCount = 0;
+	indexType = GL_UNSIGNED_INT;
+	vertexCount = 0;
+
+	instanceVBO = 0;
+	instanceCapacity = 0;
+	instanceDataVBO = 0;
+	instanceDataCapacity = 0;
+
+	arena = nullptr;
+	arenaAllocation = -1;
+
+	cacheStatsBefore.acmr = cacheStatsBefore.atvr = 0.0f;
+	cacheStatsAfter = cacheStatsBefore;
+
+	sharedGeometry = false;
+	geometryHash = 0;
+
+	bufferUsage = GL_STATIC_DRAW;
+	vertexBufferSize = 0;
+	indexBufferSize = 0;
+	updateMode = UPDATE_SUB_DATA;
+	updateRegion = 0;
+	updateRegionDrawn = false;
+	for (GLuint i = 0; i < UPDATE_REGION_COUNT; i++)
+		updateFences[i] = 0;
 }
 
-void Mesh::CreateMesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices)
+Mesh::Mesh(Mesh&& other) noexcept : Mesh()
 {
+	*this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	ClearMesh();
+
+	//The GL names change owner, other is left as an empty mesh
+	VAO = other.VAO;
+	VBO = other.VBO;
+	IBO = other.IBO;
+	indexCount = other.indexCount;
+	indexType = other.indexType;
+
+	layout = std::move(other.layout);
+	vertexCount = other.vertexCount;
+	streamOffsets = std::move(other.streamOffsets);
+
+	cacheStatsBefore = other.cacheStatsBefore;
+	cacheStatsAfter = other.cacheStatsAfter;
+
+	meshlets = std::move(other.meshlets);
+	clusterCounts = std::move(other.clusterCounts);
+	clusterOffsets = std::move(other.clusterOffsets);
+
+	lodLevels = std::move(other.lodLevels);
+	bounds = other.bounds;
+
+	instanceVBO = other.instanceVBO;
+	instanceCapacity = other.instanceCapacity;
+	instanceDataVBO = other.instanceDataVBO;
+	instanceDataCapacity = other.instanceDataCapacity;
+
+	arena = other.arena;
+	arenaAllocation = other.arenaAllocation;
+
+	sharedGeometry = other.sharedGeometry;
+	geometryHash = other.geometryHash;
+
+	bufferUsage = other.bufferUsage;
+	vertexBufferSize = other.vertexBufferSize;
+	indexBufferSize = other.indexBufferSize;
+	updateMode = other.updateMode;
+	vertexCopy = std::move(other.vertexCopy);
+	indexCopy = std::move(other.indexCopy);
+	updateRegion = other.updateRegion;
+	updateRegionDrawn = other.updateRegionDrawn;
+	for (GLuint i = 0; i < UPDATE_REGION_COUNT; i++)
+	{
+		updateFences[i] = other.updateFences[i];
+		other.updateFences[i] = 0;
+	}
+
+	other.VAO = 0;
+	other.VBO = 0;
+	other.IBO = 0;
+	other.indexCount = 0;
+	other.vertexCount = 0;
+	other.instanceVBO = 0;
+	other.instanceCapacity = 0;
+	other.instanceDataVBO = 0;
+	other.instanceDataCapacity = 0;
+	other.arena = nullptr;
+	other.arenaAllocation = -1;
+	other.sharedGeometry = false;
+	other.geometryHash = 0;
+	other.updateMode = UPDATE_SUB_DATA;
+	other.ClearMesh();
+
+	return *this;
+}
+
+void Mesh::CreateMesh(GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices, unsigned int flags)
+{
+	const void* streams[] = { vertices };
+	CreateMesh(VertexLayout::Positions(), streams, numOfVertices / 3, indices, numOfIndices, flags);
+}
+
+void Mesh::CreateMesh(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, unsigned int* indices, unsigned int numOfIndices, unsigned int flags)
+{
+	MeshData data;
+	data.layout = layout;
+	data.numOfVertices = numOfVertices;
+	for (GLuint i = 0; i < layout.GetStreamCount(); i++)
+		data.SetStream(i, streams[i]);
+	data.SetIndices(indices, numOfIndices);
+
+	CreateMesh(data, flags);
+}
+
+void Mesh::CreateMesh(MeshData& data, unsigned int flags)
+{
+	if (!PrepareMeshData(data, flags))
+		return;
+
+	//The bounds come with the prepared data
+	std::vector<const void*> streams = data.GetStreamPointers();
+	CreateBuffers(data.layout, streams.data(), data.numOfVertices, data.indices.data(), data.indexType, data.GetTotalIndexCount(), flags);
+	AdoptMeshData(data);
+}
+
+bool Mesh::CreateFromCooked(const char* path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return CreateFromCooked(file.GetData(), file.GetSize());
+}
+
+bool Mesh::CreateFromCooked(const void* cooked, size_t size)
+{
+	//The buffers of a previous CreateMesh would leak otherwise
+	ClearMesh();
+
+	CookedMesh::View view;
+	if (!CookedMesh::Read(cooked, size, view))
+		return false;
+
+	//Decoded right here, on the thread that owns the context; CookedMesh::Load on a loader thread avoids the wait
+	if (view.header.flags & CookedMesh::COMPRESSED)
+	{
+		MeshData data;
+		if (!CookedMesh::Decode(view, data))
+			return false;
+
+		CreateMesh(data);
+		return true;
+	}
+
+	indexType = view.header.indexType;
+	layout = view.layout;
+	vertexCount = view.header.numOfVertices;
+	indexCount = view.header.numOfIndices;
+	streamOffsets = view.streamOffsets;
+	bufferUsage = GL_STATIC_DRAW;
+	vertexBufferSize = (GLsizeiptr)view.header.vertexSize;
+	indexBufferSize = (GLsizeiptr)view.header.indexSize;
+
+	meshlets.swap(view.meshlets);
+	lodLevels.swap(view.lodLevels);
+	bounds = view.bounds;
+
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	//Both blobs are already laid out the way the buffers store them, so they are uploaded as they are
+	glGenBuffers(1, &IBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)view.header.indexSize, view.indices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)view.header.vertexSize, view.vertices, GL_STATIC_DRAW);
+
+	SetupVertexAttributes();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	return true;
+}
+
+bool Mesh::PrepareMeshData(MeshData& data, unsigned int flags)
+{
+	return data.Prepare(flags);
+}
+
+void Mesh::CreateMesh(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, const void* indices, GLenum indexType, unsigned int numOfIndices, unsigned int flags)
+{
+	CreateBuffers(layout, streams, numOfVertices, indices, indexType, numOfIndices, flags);
+
+	GLsizei positionStride = 0;
+	const float* positions = streams != nullptr ? layout.FindPositions(streams, positionStride) : nullptr;
+	bounds = Bounds::FromPositions(positions, positionStride, numOfVertices);
+}
+
+void Mesh::CreateBuffers(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, const void* indices, GLenum indexType, unsigned int numOfIndices, unsigned int flags)
+{
+	//A mesh created again would otherwise keep its old buffers, or its reference to shared geometry, forever
+	ClearMesh();
+
+	this->indexType = indexType;
+	this->layout = layout;
+	vertexCount = numOfVertices;
 	indexCount = numOfIndices;
 
+	GLsizeiptr indexBytes = (GLsizeiptr)IndexFormat::GetSize(indexType) * numOfIndices;
+
+	//Every stream goes in the same VBO, starting at a 16 byte aligned offset
+	GLsizeiptr vertexBytes = 0;
+	streamOffsets.resize(layout.GetStreamCount());
+	for (GLuint i = 0; i < layout.GetStreamCount(); i++)
+	{
+		streamOffsets[i] = vertexBytes;
+		vertexBytes += (layout.GetStreamSize(i, numOfVertices) + 15) & ~15;
+	}
+
+	//Buffers that change can not be shared, the other meshes would change with them
+	bufferUsage = (flags & STREAM_DRAW) ? GL_STREAM_DRAW : (flags & DYNAMIC_DRAW) ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+	vertexBufferSize = vertexBytes;
+	indexBufferSize = indexBytes;
+
+	std::vector<unsigned char> geometryData;
+	if ((flags & SHARE_GEOMETRY) && bufferUsage == GL_STATIC_DRAW && streams != nullptr && indices != nullptr)
+	{
+		//The layout is part of the data, the same bytes read with another layout are another mesh
+		for (size_t i = 0; i < layout.GetAttributes().size(); i++)
+		{
+			const VertexAttribute& attribute = layout.GetAttributes()[i];
+			GLint description[] = { (GLint)attribute.location, attribute.components, (GLint)attribute.type, attribute.normalized, attribute.integer, (GLint)attribute.stream, attribute.offset };
+			geometryData.insert(geometryData.end(), (const unsigned char*)description, (const unsigned char*)description + sizeof(description));
+		}
+		for (GLuint i = 0; i < layout.GetStreamCount(); i++)
+		{
+			const unsigned char* stream = (const unsigned char*)streams[i];
+			geometryData.insert(geometryData.end(), stream, stream + layout.GetStreamSize(i, numOfVertices));
+		}
+		geometryData.insert(geometryData.end(), (const unsigned char*)&indexType, (const unsigned char*)&indexType + sizeof(indexType));
+		geometryData.insert(geometryData.end(), (const unsigned char*)indices, (const unsigned char*)indices + indexBytes);
+
+		geometryHash = GeometryCache::Hash(geometryData.data(), geometryData.size(), 0);
+		sharedGeometry = true;
+
+		//Same data already on the GPU, so nothing has to be uploaded
+		GeometryCache::Entry* entry = GeometryCache::Acquire(geometryHash, geometryData);
+		if (entry != nullptr)
+		{
+			VAO = entry->VAO;
+			VBO = entry->VBO;
+			IBO = entry->IBO;
+			return;
+		}
+	}
+
 
 	//Creating the VAO  and binding to the variable VAO (vertex array object)
 	glGenVertexArrays(1, &VAO);
@@ -28,32 +297,90 @@ void Mesh::CreateMesh(GLfloat* vertices, unsigned int* indices, unsigned int num
 	//2 param - size of the data we are drawing
 	//3 param - the data we are drawing
 	//4 param - the drawing mode 
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numOfIndices, indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, bufferUsage);
 
 
 	//Creating the VBO buffer and binding it to the variable VBO (vertex buffer object)
 	glGenBuffers(1, &VBO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-	//Passing the data we want to draw to the buffer
-	//1 param - which buffer we are using to draw it
-	//2 param - size of the data we are drawing
-	//3 param - the data we are drawing
-	//4 param - the drawing mode 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);
+	//Allocating room for every stream, then copying each stream to its offset
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, NULL, bufferUsage);
+	for (GLuint i = 0; i < layout.GetStreamCount() && streams != nullptr; i++)
+		glBufferSubData(GL_ARRAY_BUFFER, streamOffsets[i], layout.GetStreamSize(i, numOfVertices), streams[i]);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
+	SetupVertexAttributes();
 
 	//Unbinding the VAO and VBO and IBO
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	//On a hash collision the buffers stay with this mesh alone
+	if (sharedGeometry && !GeometryCache::Insert(geometryHash, geometryData, VAO, VBO, IBO, vertexBytes + indexBytes))
+	{
+		sharedGeometry = false;
+		geometryHash = 0;
+	}
+}
+
+void Mesh::CreateEmptyMesh(const VertexLayout& layout, unsigned int numOfVertices, GLenum indexType, unsigned int numOfIndices, unsigned int flags)
+{
+	CreateBuffers(layout, nullptr, numOfVertices, nullptr, indexType, numOfIndices, flags & (DYNAMIC_DRAW | STREAM_DRAW));
+
+	//Nothing is drawn until every byte is there
+	indexCount = 0;
+	bounds = Bounds();
+}
+
+void Mesh::FinishUpload(MeshData& data)
+{
+	AdoptMeshData(data);
+}
+
+void Mesh::AdoptMeshData(MeshData& data)
+{
+	//RenderMesh and the meshlets only cover the full detail level
+	indexCount = data.numOfIndices;
+
+	cacheStatsBefore = data.cacheStatsBefore;
+	cacheStatsAfter = data.cacheStatsAfter;
+	meshlets.swap(data.meshlets);
+	lodLevels.swap(data.lodLevels);
+	bounds = data.bounds;
+}
+
+void Mesh::CreateMesh(GeometryArena* arena, GLfloat* vertices, unsigned int* indices, unsigned int numOfVertices, unsigned int numOfIndices)
+{
+	//Gives back the previous allocation (or buffers) of this mesh first, it would be lost otherwise
+	ClearMesh();
+
+	arenaAllocation = arena->Allocate(vertices, indices, numOfVertices, numOfIndices);
+	if (arenaAllocation < 0)
+	{
+		printf("Mesh could not be stored in the geometry arena!\n");
+		return;
+	}
+
+	this->arena = arena;
+	layout = VertexLayout::Positions();
+	vertexCount = numOfVertices / GeometryArena::VERTEX_SIZE;
+	indexType = GL_UNSIGNED_INT;
+	indexCount = numOfIndices;
+	bounds = Bounds::FromPositions(vertices, sizeof(GLfloat) * GeometryArena::VERTEX_SIZE, vertexCount);
 }
 
 void Mesh::RenderMesh()
 {
+	if (arena != nullptr)
+	{
+		arena->Bind();
+		arena->Draw(arenaAllocation);
+		arena->Unbind();
+		return;
+	}
+
 	//If there is nothing to draw, then return
 	if (VAO == 0 || VBO == 0 || IBO == 0)
 		return;
@@ -63,7 +390,8 @@ void Mesh::RenderMesh()
 	//binding the shader program to specific IBO
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
 
-	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+	FenceUpdateRegion();
 
 	//Unbinding the VAO
 	glBindVertexArray(0);
@@ -71,9 +399,496 @@ void Mesh::RenderMesh()
 
 }
 
+void Mesh::RenderMeshInstanced(const glm::mat4* instanceModels, GLsizei instanceCount)
+{
+	RenderMeshInstanced(instanceModels, nullptr, instanceCount);
+}
+
+void Mesh::RenderMeshInstanced(const glm::mat4* instanceModels, const glm::vec4* instanceData, GLsizei instanceCount)
+{
+	//If there is nothing to draw, then return
+	if (VAO == 0 || VBO == 0 || IBO == 0 || instanceCount <= 0)
+		return;
+
+	glBindVertexArray(VAO);
+
+	if (instanceVBO == 0)
+		CreateInstanceBuffer();
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+	//A shared VAO may still point at the instance buffer of another mesh using the same geometry
+	if (sharedGeometry)
+		SetupInstanceAttributes();
+
+	UploadInstances(sizeof(glm::mat4), instanceCapacity, instanceModels, instanceCount);
+
+	if (instanceData != nullptr)
+	{
+		if (instanceDataVBO == 0)
+			glGenBuffers(1, &instanceDataVBO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, instanceDataVBO);
+		glVertexAttribPointer(INSTANCE_DATA_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+		glEnableVertexAttribArray(INSTANCE_DATA_LOCATION);
+		glVertexAttribDivisor(INSTANCE_DATA_LOCATION, 1);
+
+		UploadInstances(sizeof(glm::vec4), instanceDataCapacity, instanceData, instanceCount);
+	}
+	else
+	{
+		//Shaders reading the data get (0, 0, 0, 1) instead of the values of an older draw
+		glDisableVertexAttribArray(INSTANCE_DATA_LOCATION);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+
+	//Draws every copy at once, the instance attributes advance once per copy instead of once per vertex
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instanceCount);
+	FenceUpdateRegion();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+GLsizei Mesh::RenderMeshClusters(const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+	if (VAO == 0 || VBO == 0 || IBO == 0)
+		return 0;
+
+	if (meshlets.empty())
+	{
+		RenderMesh();
+		return 0;
+	}
+
+	//Testing in object space, so the meshlet bounds do not have to be transformed
+	//The planes of projection * view * model are the camera planes in object space
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection * model);
+	glm::vec3 objectCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+	//The normal cones measure angles, which only a uniform scale keeps. A model stretched along one axis tilts
+	//the normals out of their cone, so the back face test is skipped rather than culling visible meshlets
+	glm::vec3 scale(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+	float largestScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+	float smallestScale = glm::min(scale.x, glm::min(scale.y, scale.z));
+	bool testCones = smallestScale >= largestScale * 0.999f;
+
+	clusterCounts.clear();
+	clusterOffsets.clear();
+	GLsizei indexSize = IndexFormat::GetSize(indexType);
+	GLsizei drawn = 0;
+	unsigned int rangeEnd = ~0u;
+
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+
+		if (!frustum.IsSphereVisible(meshlet.centre, meshlet.radius) || (testCones && MeshletBuilder::IsBackFacing(meshlet, objectCamera)))
+			continue;
+
+		drawn++;
+
+		//Meshlets next to each other in the index buffer are drawn as one range
+		if (meshlet.firstIndex == rangeEnd)
+		{
+			clusterCounts.back() += meshlet.indexCount;
+		}
+		else
+		{
+			clusterCounts.push_back(meshlet.indexCount);
+			clusterOffsets.push_back((const void*)((size_t)meshlet.firstIndex * indexSize));
+		}
+		rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+	}
+
+	if (clusterCounts.empty())
+		return 0;
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+
+	//Every visible range in one call
+	glMultiDrawElements(GL_TRIANGLES, clusterCounts.data(), indexType, clusterOffsets.data(), (GLsizei)clusterCounts.size());
+	FenceUpdateRegion();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	return drawn;
+}
+
+GLsizei Mesh::RenderMeshLOD(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelError)
+{
+	if (VAO == 0 || VBO == 0 || IBO == 0)
+		return 0;
+
+	if (lodLevels.empty())
+	{
+		RenderMesh();
+		return 0;
+	}
+
+	//The model matrix can scale the mesh, and its errors with it
+	float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	//Distance to the closest point of the sphere, not less than the near plane distance
+	glm::vec3 viewCentre = glm::vec3(view * model * glm::vec4(bounds.centre, 1.0f));
+	float distance = glm::max(glm::length(viewCentre) - bounds.radius * scale, 0.01f);
+
+	//projection[1][1] is 1 / tan(fov / 2), so this turns a distance at the mesh into a fraction of half the screen
+	float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f / distance;
+
+	GLsizei level = 0;
+	for (size_t i = 1; i < lodLevels.size(); i++)
+	{
+		if (lodLevels[i].error * scale * pixelsPerUnit > pixelError)
+			break;
+		level = (GLsizei)i;
+	}
+
+	const LODLevel& lod = lodLevels[level];
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+
+	glDrawElements(GL_TRIANGLES, lod.indexCount, indexType, (const void*)((size_t)lod.firstIndex * IndexFormat::GetSize(indexType)));
+	FenceUpdateRegion();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	return level;
+}
+
+bool Mesh::SetUpdateMode(unsigned int mode)
+{
+	if (VAO == 0 || arena != nullptr || sharedGeometry)
+	{
+		printf("Only a mesh with its own buffers can be updated!\n");
+		return false;
+	}
+
+	if (mode == updateMode)
+		return true;
+
+	//The copies in memory start as what the buffers hold now
+	if (vertexCopy.empty())
+	{
+		vertexCopy.resize((size_t)vertexBufferSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr)updateRegion * vertexBufferSize, vertexBufferSize, vertexCopy.data());
+
+		indexCopy.resize((size_t)indexBufferSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, IBO);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indexBufferSize, indexCopy.data());
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	//The vertex buffer grows to a region per copy, or shrinks back to one
+	GLuint regions = mode == UPDATE_UNSYNCHRONIZED ? UPDATE_REGION_COUNT : 1;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, vertexBufferSize * regions, NULL, bufferUsage);
+	for (GLuint i = 0; i < regions; i++)
+		glBufferSubData(GL_COPY_WRITE_BUFFER, vertexBufferSize * i, vertexBufferSize, vertexCopy.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	std::vector<unsigned char> keptVertices, keptIndices;
+	if (mode != UPDATE_SUB_DATA)
+	{
+		keptVertices.swap(vertexCopy);
+		keptIndices.swap(indexCopy);
+	}
+	ReleaseUpdateData();
+	vertexCopy.swap(keptVertices);
+	indexCopy.swap(keptIndices);
+	updateMode = mode;
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	SetupVertexAttributes();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	return true;
+}
+
+bool Mesh::UpdateVertices(GLuint stream, const void* data, unsigned int firstVertex, unsigned int numOfVertices)
+{
+	if (VAO == 0 || arena != nullptr || sharedGeometry)
+	{
+		printf("Only a mesh with its own buffers can be updated!\n");
+		return false;
+	}
+
+	if (stream >= layout.GetStreamCount() || (GLsizei)firstVertex > vertexCount || (GLsizei)numOfVertices > vertexCount - (GLsizei)firstVertex)
+	{
+		printf("Vertices %u to %u of stream %u are outside the mesh!\n", firstVertex, firstVertex + numOfVertices, stream);
+		return false;
+	}
+
+	if (numOfVertices == 0)
+		return true;
+
+	GLsizei stride = layout.GetStride(stream);
+	GLintptr offset = streamOffsets[stream] + (GLintptr)firstVertex * stride;
+	GLsizeiptr size = (GLsizeiptr)numOfVertices * stride;
+
+	if (updateMode == UPDATE_SUB_DATA)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return true;
+	}
+
+	memcpy(vertexCopy.data() + offset, data, (size_t)size);
+
+	if (updateMode == UPDATE_ORPHAN)
+	{
+		//Giving the data with the size is the same as orphaning with NULL and filling the new storage
+		glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+		glBufferData(GL_COPY_WRITE_BUFFER, vertexBufferSize, vertexCopy.data(), bufferUsage);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return true;
+	}
+
+	//The region has not been drawn since it was written, only the range changes
+	if (!updateRegionDrawn)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+		void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)updateRegion * vertexBufferSize + offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (mapped != nullptr)
+		{
+			memcpy(mapped, data, (size_t)size);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return mapped != nullptr;
+	}
+
+	//A draw may still be reading the region, the whole mesh moves on to the next one
+	WriteVertexRegion((updateRegion + 1) % UPDATE_REGION_COUNT);
+	return true;
+}
+
+bool Mesh::UpdateIndices(const unsigned int* indices, unsigned int firstIndex, unsigned int numOfIndices)
+{
+	if (VAO == 0 || arena != nullptr || sharedGeometry)
+	{
+		printf("Only a mesh with its own buffers can be updated!\n");
+		return false;
+	}
+
+	GLsizei indexSize = IndexFormat::GetSize(indexType);
+	if ((GLsizeiptr)firstIndex * indexSize > indexBufferSize || (GLsizeiptr)numOfIndices * indexSize > indexBufferSize - (GLsizeiptr)firstIndex * indexSize)
+	{
+		printf("Indices %u to %u are outside the mesh!\n", firstIndex, firstIndex + numOfIndices);
+		return false;
+	}
+
+	//Indices that do not fit the type would silently point at other vertices
+	unsigned int maxIndex = indexType == GL_UNSIGNED_BYTE ? 0xFF : indexType == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF;
+	for (unsigned int i = 0; i < numOfIndices; i++)
+	{
+		if (indices[i] > maxIndex)
+		{
+			printf("Index %u does not fit the index type of the mesh!\n", indices[i]);
+			return false;
+		}
+	}
+
+	if (numOfIndices == 0)
+		return true;
+
+	GLintptr offset = (GLintptr)firstIndex * indexSize;
+	GLsizeiptr size = (GLsizeiptr)numOfIndices * indexSize;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, IBO);
+	if (updateMode == UPDATE_SUB_DATA)
+	{
+		std::vector<unsigned char> narrowed((size_t)size);
+		IndexFormat::Narrow(indices, numOfIndices, indexType, narrowed.data());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, narrowed.data());
+	}
+	else
+	{
+		IndexFormat::Narrow(indices, numOfIndices, indexType, indexCopy.data() + offset);
+		glBufferData(GL_COPY_WRITE_BUFFER, indexBufferSize, indexCopy.data(), bufferUsage);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	return true;
+}
+
+void Mesh::WriteVertexRegion(GLuint region)
+{
+	//The last draw reading this region was issued before the other regions were written, it is almost always done
+	if (updateFences[region] != 0)
+	{
+		GLenum status = glClientWaitSync(updateFences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(updateFences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+		glDeleteSync(updateFences[region]);
+		updateFences[region] = 0;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+	void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)region * vertexBufferSize, vertexBufferSize,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (mapped != nullptr)
+	{
+		memcpy(mapped, vertexCopy.data(), vertexCopy.size());
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+
+	//The attributes of the VAO now read the new region
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	SetupVertexAttributes((GLintptr)region * vertexBufferSize);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	updateRegion = region;
+	updateRegionDrawn = false;
+}
+
+void Mesh::FenceUpdateRegion()
+{
+	if (updateMode != UPDATE_UNSYNCHRONIZED)
+		return;
+
+	//Only the last draw of the region matters, the draws before it finish first
+	if (updateFences[updateRegion] != 0)
+		glDeleteSync(updateFences[updateRegion]);
+	updateFences[updateRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	updateRegionDrawn = true;
+}
+
+void Mesh::ReleaseUpdateData()
+{
+	for (GLuint i = 0; i < UPDATE_REGION_COUNT; i++)
+	{
+		if (updateFences[i] != 0)
+		{
+			glDeleteSync(updateFences[i]);
+			updateFences[i] = 0;
+		}
+	}
+
+	std::vector<unsigned char>().swap(vertexCopy);
+	std::vector<unsigned char>().swap(indexCopy);
+	updateMode = UPDATE_SUB_DATA;
+	updateRegion = 0;
+	updateRegionDrawn = false;
+}
+
+void Mesh::SetupVertexAttributes(GLintptr baseOffset)
+{
+	//Expects the VAO and VBO of this mesh to be bound, baseOffset is where the copy of the vertices drawn starts
+	const std::vector<VertexAttribute>& attributes = layout.GetAttributes();
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const VertexAttribute& attribute = attributes[i];
+		GLsizei stride = layout.GetStride(attribute.stream);
+		const void* offset = (const void*)(baseOffset + streamOffsets[attribute.stream] + attribute.offset);
+
+		//Integer attributes keep their value, the others are converted to float (and normalized if asked)
+		if (attribute.integer)
+			glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, stride, offset);
+		else
+			glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride, offset);
+
+		glEnableVertexAttribArray(attribute.location);
+	}
+}
+
+void Mesh::CreateInstanceBuffer()
+{
+	//Expects the VAO of this mesh to be bound
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+	SetupInstanceAttributes();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::SetupInstanceAttributes()
+{
+	//Expects the VAO of this mesh and its instance buffer to be bound
+	//A mat4 attribute is passed as 4 vec4 columns, each one in its own location
+	for (GLuint i = 0; i < 4; i++)
+	{
+		GLuint location = INSTANCE_MODEL_LOCATION + i;
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
+		glEnableVertexAttribArray(location);
+
+		//1 - the attribute moves to the next value once per instance and not once per vertex
+		glVertexAttribDivisor(location, 1);
+	}
+}
+
+void Mesh::UploadInstances(GLsizeiptr instanceSize, GLsizei& capacity, const void* instances, GLsizei instanceCount)
+{
+	//Expects the instance buffer to be bound
+	if (instanceCount > capacity)
+	{
+		//Not enough room, so the buffer is reallocated with the new size
+		capacity = instanceCount;
+		glBufferData(GL_ARRAY_BUFFER, instanceSize * capacity, instances, GL_STREAM_DRAW);
+	}
+	else
+	{
+		//Orphaning the old storage, so the driver does not have to wait for the previous frame to finish reading it
+		glBufferData(GL_ARRAY_BUFFER, instanceSize * capacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instanceSize * instanceCount, instances);
+	}
+}
 
 void Mesh::ClearMesh()
 {
+	if (instanceVBO != 0)
+	{
+		glDeleteBuffers(1, &instanceVBO);
+		instanceVBO = 0;
+	}
+	instanceCapacity = 0;
+
+	if (instanceDataVBO != 0)
+	{
+		glDeleteBuffers(1, &instanceDataVBO);
+		instanceDataVBO = 0;
+	}
+	instanceDataCapacity = 0;
+
+	if (arena != nullptr)
+	{
+		//The arena owns the buffers, the mesh only gives its range back
+		arena->Free(arenaAllocation);
+		arena = nullptr;
+		arenaAllocation = -1;
+	}
+
+	if (sharedGeometry)
+	{
+		//Other meshes may still be drawing with these buffers, only the last one deletes them
+		if (!GeometryCache::Release(geometryHash))
+		{
+			IBO = 0;
+			VBO = 0;
+			VAO = 0;
+		}
+		sharedGeometry = false;
+		geometryHash = 0;
+	}
+
 	if (IBO != 0)
 	{
 		//deletes the buffer off the graphics card to free up space - to avoid memory overflow
@@ -95,7 +910,16 @@ void Mesh::ClearMesh()
 		VAO = 0;
 	}
 
+	ReleaseUpdateData();
+	bufferUsage = GL_STATIC_DRAW;
+	vertexBufferSize = 0;
+	indexBufferSize = 0;
+
 	indexCount = 0;
+	vertexCount = 0;
+	streamOffsets.clear();
+	meshlets.clear();
+	lodLevels.clear();
 }
 
 Mesh::~Mesh()
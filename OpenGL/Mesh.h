@@ -1,45 +1,315 @@
 #pragma once
 
+#include <stdio.h>
+#include <vector>
+
 #include <GL\glew.h>
 
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "GeometryArena.h"
+#include "GeometryCache.h"
+#include "IndexFormat.h"
+#include "MeshOptimizer.h"
+#include "MeshData.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "Frustum.h"
+#include "VertexLayout.h"
+
 /*
 Class that contains all information related to the data within a model
 VAO - Vertex Array Object
 VBO - Vertex Buffer Object
 IBO - Indeces Buffer Object
+instanceVBO - Per-instance model matrices, only created once the mesh is drawn instanced
+instanceDataVBO - Per-instance vec4 of the shader, only created once the mesh is drawn with one
 
 indexCount - How many indices to draw 
 */
-class Mesh
+class Mesh : public MeshFlags
 {
-
 public: 
 	Mesh();
 
+	//A mesh owns its GL names, so it can be moved but never copied (two copies would delete the same buffers)
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&& other) noexcept;
+	Mesh& operator=(Mesh&& other) noexcept;
+
 	/**
-	* Compute mesh through the parameters assigned.
+	* Compute mesh through the parameters assigned, with 3 floats of position per vertex.
 	 *
+	* @param numOfVertices The number of floats inside vertices
+	* @param numOfIndices The number of indices inside the mesh
+	* @param flags Combination of the mesh flags below (SHARE_GEOMETRY, BYTE_INDICES, OPTIMIZE, BUILD_MESHLETS, BUILD_LODS, GENERATE_NORMALS, GENERATE_TANGENTS, DYNAMIC_DRAW, STREAM_DRAW)
+	*/
+	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices, unsigned int flags = 0);
+
+	/**
+	* Compute mesh with any vertex layout, one array of data per stream of the layout.
+	* Every stream is stored in the same VBO, one after the other.
+	* Attributes must not use the locations taken by the instance attributes (4 to 8 and 12).
+	* Indices are stored in the smallest type that fits them, GL_UNSIGNED_SHORT for most meshes.
+	*
+	* @param layout Attributes of a vertex and how they are stored
+	* @param streams Vertex data of each stream, layout.GetStreamCount() arrays
+	* @param numOfVertices The number of vertices inside the mesh (vertices, not floats)
+	* @param numOfIndices The number of indices inside the mesh
+	* @param flags Combination of the mesh flags below (SHARE_GEOMETRY, BYTE_INDICES, OPTIMIZE, BUILD_MESHLETS, BUILD_LODS, GENERATE_NORMALS, GENERATE_TANGENTS, DYNAMIC_DRAW, STREAM_DRAW)
+	*/
+	void CreateMesh(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, unsigned int *indices, unsigned int numOfIndices, unsigned int flags = 0);
+
+	/**
+	* Compute mesh from data held in memory. The data is prepared first if it has not been yet,
+	* its meshlets and levels of detail are moved into the mesh.
+	*
+	* @param flags Used when the data still has to be prepared, and for SHARE_GEOMETRY
+	*/
+	void CreateMesh(MeshData& data, unsigned int flags = 0);
+
+	/**
+	* Compute mesh with indices that are already stored in their final type, they are uploaded as they are.
+	* With streams and indices left nullptr the buffers are only allocated, CreateEmptyMesh does the same for data copied in later.
+	* The bounds are computed from the positions when they are stored as 3 floats.
+	*
+	* @param indexType GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	*/
+	void CreateMesh(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, const void* indices, GLenum indexType, unsigned int numOfIndices, unsigned int flags = 0);
+
+	/**
+	* Compute mesh inside a shared GeometryArena instead of creating its own buffers.
+	* To draw many arena meshes without switching VAO, bind the arena once and call GeometryArena::Draw
+	* with GetArenaAllocation(), RenderMesh binds and unbinds the arena on every call.
+	* The mesh keeps a pointer to the arena, so the arena must outlive the mesh (or the mesh be cleared first).
+	*
+	* @param arena The arena that stores the vertices and indices
 	* @param numOfVertices The number of vertices inside the mesh
 	* @param numOfIndices The number of indices inside the mesh
 	*/
-	void CreateMesh(GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices);
+	void CreateMesh(GeometryArena* arena, GLfloat *vertices, unsigned int *indices, unsigned int numOfVertices, unsigned int numOfIndices);
+
+	/**
+	* Compute mesh from a cooked file written by the MeshCooker tool (see CookedMesh). The file is mapped and its
+	* vertex and index blobs go to glBufferData as they are, along with its levels of detail and meshlets.
+	* A compressed file is decoded on this thread first, pass CookedMesh::Load to a MeshUploader to decode it on a worker.
+	*
+	* @return false when the file can not be read
+	*/
+	bool CreateFromCooked(const char* path);
+
+	/**
+	* Compute mesh from a cooked file already in memory.
+	*/
+	bool CreateFromCooked(const void* cooked, size_t size);
+
+	/**
+	* Runs every CPU pass of CreateMesh on the data (GENERATE_NORMALS, GENERATE_TANGENTS, OPTIMIZE, BUILD_MESHLETS, BUILD_LODS, index narrowing)
+	* without touching OpenGL, so it can be called from any thread. Same as data.Prepare(flags).
+	*
+	* @param flags The same flags the mesh will be created with
+	*/
+	static bool PrepareMeshData(MeshData& data, unsigned int flags);
+
+	/**
+	* Chooses how UpdateVertices and UpdateIndices reach the GPU (UPDATE_SUB_DATA, UPDATE_ORPHAN or UPDATE_UNSYNCHRONIZED).
+	* The last two keep a copy of the buffers in memory, read back from the GPU once here.
+	* Meshes sharing their geometry or stored in a GeometryArena can not be updated.
+	*
+	* @return false when the mesh can not be updated
+	*/
+	bool SetUpdateMode(unsigned int mode);
+
+	/**
+	* Replaces a range of vertices of one stream, without reallocating the buffers.
+	* The bounds, meshlets and levels of detail are kept as they are, see SetBounds.
+	*
+	* @param stream The stream of the layout the data belongs to
+	* @param data The new vertices, stored as the stream stores them
+	* @param firstVertex The first vertex replaced
+	* @param numOfVertices How many vertices are replaced
+	* @return false when the range goes past the end of the mesh or the mesh can not be updated
+	*/
+	bool UpdateVertices(GLuint stream, const void* data, unsigned int firstVertex, unsigned int numOfVertices);
+
+	/**
+	* Replaces a range of indices, stored in the index type of the mesh. Every index has to fit in that type.
+	*
+	* @param firstIndex The first index replaced
+	* @param numOfIndices How many indices are replaced
+	* @return false when the range goes past the end of the index buffer or an index does not fit
+	*/
+	bool UpdateIndices(const unsigned int* indices, unsigned int firstIndex, unsigned int numOfIndices);
+
+	/*Replaces the bounds, for meshes whose vertices moved. Deforming meshes usually set bounds holding every pose once*/
+	void SetBounds(const Bounds& bounds) { this->bounds = bounds; }
 
 	/**
 	* Renders the mesh on screen.
 	*/
 	void RenderMesh();
 
+	/**
+	* Renders many copies of the mesh with a single draw call.
+	* Every copy reads its own model matrix from a per-instance vertex attribute (see Shaders/shader_instanced.vert),
+	* so no model uniform has to be set between copies.
+	* Only meshes with their own buffers can be drawn this way, not meshes stored in a GeometryArena.
+	*
+	* @param instanceModels Array of model matrices, one for each copy
+	* @param instanceCount The number of copies to draw
+	*/
+	void RenderMeshInstanced(const glm::mat4* instanceModels, GLsizei instanceCount);
+
+	/**
+	* Same, with one more vec4 per copy at INSTANCE_DATA_LOCATION for the shader to use as it likes
+	* (e.g. the clip and start time of a baked animation, see VertexAnimation).
+	*
+	* @param instanceData Array of vec4, one for each copy, nullptr for none
+	*/
+	void RenderMeshInstanced(const glm::mat4* instanceModels, const glm::vec4* instanceData, GLsizei instanceCount);
+
+	/**
+	* Renders only the meshlets that can be seen, skipping the ones outside the camera view and the ones
+	* facing away from the camera (only tested when the model scales every axis the same).
+	* The visible ranges go out in a single glMultiDrawElements.
+	* Meshes created without BUILD_MESHLETS are drawn whole.
+	*
+	* @param model The model matrix the mesh is drawn with
+	* @param viewProjection The projection matrix multiplied by the view matrix
+	* @param cameraPosition The camera position in world space
+	* @return The number of meshlets drawn
+	*/
+	GLsizei RenderMeshClusters(const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+	/**
+	* Renders the coarsest level of detail whose error stays under a number of pixels on screen.
+	* The error of each level is projected with the distance of the mesh from the camera and the projection matrix.
+	* Meshes created without BUILD_LODS are drawn whole.
+	*
+	* @param model The model matrix the mesh is drawn with
+	* @param view The view matrix of the camera
+	* @param projection The projection matrix, the same one given to the shader
+	* @param viewportHeight Height of the screen in pixels
+	* @param pixelError How many pixels the surface may move on screen
+	* @return The level drawn, 0 is the full detail mesh
+	*/
+	GLsizei RenderMeshLOD(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelError = 1.0f);
+
+	/**
+	* Creates the buffers of a mesh without filling them, for data copied in later (see MeshUploader).
+	* The mesh draws nothing until FinishUpload.
+	*
+	* @param numOfIndices Every index of the prepared data, the LOD levels included (MeshData::GetTotalIndexCount)
+	* @param flags Only DYNAMIC_DRAW and STREAM_DRAW matter, the data is already prepared
+	*/
+	void CreateEmptyMesh(const VertexLayout& layout, unsigned int numOfVertices, GLenum indexType, unsigned int numOfIndices, unsigned int flags = 0);
+
+	/**
+	* Called once the buffers of CreateEmptyMesh hold the streams and indices of data, the mesh can be drawn after it.
+	* Takes the meshlets, LOD levels and bounds of the prepared data.
+	*/
+	void FinishUpload(MeshData& data);
+
+	/*The buffers to copy the data of CreateEmptyMesh into, each stream starts at its offset in the vertex buffer*/
+	GLuint GetVertexBuffer() { return VBO; }
+	GLuint GetIndexBuffer() { return IBO; }
+	GLintptr GetStreamOffset(GLuint stream) { return streamOffsets[stream]; }
+
 	/**
 	Clear all buffers from the GPU, to avoid memory overflow issues and sets them back to 0.
 	It does NOT destroy the class Mesh.
 	*/
 	void ClearMesh();
 
+	const VertexLayout& GetLayout() { return layout; }
+	GLenum GetIndexType() { return indexType; }
+
+	/*Post-transform cache efficiency before and after the OPTIMIZE pass, zero when the mesh was not optimized*/
+	MeshOptimizer::CacheStats GetCacheStatsBefore() { return cacheStatsBefore; }
+	MeshOptimizer::CacheStats GetCacheStatsAfter() { return cacheStatsAfter; }
+	GLsizei GetVertexCount() { return vertexCount; }
+	const std::vector<Meshlet>& GetMeshlets() { return meshlets; }
+	const std::vector<LODLevel>& GetLODLevels() { return lodLevels; }
+
+	/*Box and sphere around the mesh in object space, empty when its positions are not stored as 3 floats*/
+	const Bounds& GetBounds() const { return bounds; }
+
+	/*The bounds moved into world space by the model matrix the mesh is drawn with*/
+	Bounds GetWorldBounds(const glm::mat4& model) const { return bounds.Transform(model); }
+
+	unsigned int GetUpdateMode() { return updateMode; }
+
+	GeometryArena* GetArena() { return arena; }
+	GLint GetArenaAllocation() { return arenaAllocation; }
+
 	~Mesh();
 
+	//Update modes for SetUpdateMode
+	//glBufferSubData on the range, the driver copies the data or waits for the draws still reading the buffer
+	static const unsigned int UPDATE_SUB_DATA = 0;
+	//The whole buffer is specified again from the copy in memory, the driver gives it new storage instead of waiting.
+	//Best when most of the mesh changes every frame
+	static const unsigned int UPDATE_ORPHAN = 1;
+	//The vertex buffer holds UPDATE_REGION_COUNT copies of the vertices, written through glMapBufferRange without
+	//any driver synchronization. A fence after each draw tells when a copy is free again. Best for many small
+	//updates in a frame; indices are updated as with UPDATE_ORPHAN
+	static const unsigned int UPDATE_UNSYNCHRONIZED = 2;
+	static const GLuint UPDATE_REGION_COUNT = 3;
+
+	//First attribute location of the instance model matrix, a mat4 takes 4 locations (4, 5, 6 and 7)
+	static const GLuint INSTANCE_MODEL_LOCATION = 4;
+
+	//Location of the per-instance vec4 of RenderMeshInstanced, after the joints and weights of VertexLayout
+	static const GLuint INSTANCE_DATA_LOCATION = 12;
 
 private:
 	GLuint VAO, VBO, IBO;
 	GLsizei indexCount; 
+	GLenum indexType;
+
+	VertexLayout layout;
+	GLsizei vertexCount;
+	std::vector<GLintptr> streamOffsets;	//where each stream starts inside the VBO
+
+	MeshOptimizer::CacheStats cacheStatsBefore, cacheStatsAfter;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<GLsizei> clusterCounts;			//reused every frame by RenderMeshClusters
+	std::vector<const void*> clusterOffsets;
+
+	std::vector<LODLevel> lodLevels;
+	Bounds bounds;
+
+	GLuint instanceVBO;
+	GLsizei instanceCapacity;
+	GLuint instanceDataVBO;
+	GLsizei instanceDataCapacity;
+
+	GeometryArena* arena;
+	GLint arenaAllocation;
+
+	//Set when the buffers belong to the GeometryCache and may be used by other meshes too
+	bool sharedGeometry;
+	unsigned long long geometryHash;
+
+	GLenum bufferUsage;
+	GLsizeiptr vertexBufferSize, indexBufferSize;	//bytes of the vertices (one region) and of the indices
+	unsigned int updateMode;
+	std::vector<unsigned char> vertexCopy, indexCopy;	//what the buffers hold, kept by UPDATE_ORPHAN and UPDATE_UNSYNCHRONIZED
+	GLuint updateRegion;							//the copy of the vertices drawn with UPDATE_UNSYNCHRONIZED
+	bool updateRegionDrawn;
+	GLsync updateFences[UPDATE_REGION_COUNT];		//after the last draw reading each region
+
+	void CreateBuffers(const VertexLayout& layout, const void* const* streams, unsigned int numOfVertices, const void* indices, GLenum indexType, unsigned int numOfIndices, unsigned int flags);
+	void AdoptMeshData(MeshData& data);
+	void SetupVertexAttributes(GLintptr baseOffset = 0);
+	void FenceUpdateRegion();
+	void WriteVertexRegion(GLuint region);
+	void ReleaseUpdateData();
+	void CreateInstanceBuffer();
+	void SetupInstanceAttributes();
+	void UploadInstances(GLsizeiptr instanceSize, GLsizei& capacity, const void* instances, GLsizei instanceCount);
 };
 
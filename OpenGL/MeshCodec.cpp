@@ -0,0 +1,409 @@
+#include "MeshCodec.h"
+
+#include <string.h>
+#include <vector>
+
+#include "Simd.h"
+
+namespace
+{
+	const unsigned char VERTEX_FORMAT = 0xA1;
+	const unsigned char INDEX_FORMAT = 0xB1;
+
+	//Differences are packed in groups of 16, a 2 bit mode per group says how many bits each one takes
+	const size_t GROUP_SIZE = 16;
+	const size_t GROUPS_PER_BLOCK = MeshCodec::BLOCK_VERTICES / GROUP_SIZE;
+	const size_t PAYLOAD_SIZE[4] = { 0, 4, 8, 16 };
+
+	//Small negative differences become small positive numbers: 0, -1, 1, -2, 2...
+	unsigned char ZigZag(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	void EncodeGroup(unsigned char* destination, const unsigned char* group, unsigned int mode)
+	{
+		//2 bits: byte j holds values j, j + 4, j + 8 and j + 12. 4 bits: byte j holds values j and j + 8.
+		//Each value lands in its own lane once the decoder shifts and masks the bytes, nothing has to be shuffled
+		if (mode == 1)
+		{
+			for (size_t j = 0; j < 4; j++)
+				destination[j] = (unsigned char)(group[j] | (group[j + 4] << 2) | (group[j + 8] << 4) | (group[j + 12] << 6));
+		}
+		else if (mode == 2)
+		{
+			for (size_t j = 0; j < 8; j++)
+				destination[j] = (unsigned char)(group[j] | (group[j + 8] << 4));
+		}
+		else if (mode == 3)
+			memcpy(destination, group, GROUP_SIZE);
+	}
+
+#ifdef SIMD_SSE2
+	__m128i UnpackGroup(const unsigned char* data, unsigned int mode)
+	{
+		if (mode == 1)
+		{
+			int word;
+			memcpy(&word, data, sizeof(word));
+			__m128i packed = _mm_cvtsi32_si128(word);
+			__m128i mask = _mm_set1_epi8(3);
+
+			__m128i a = _mm_and_si128(packed, mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+			__m128i c = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+			__m128i d = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+			return _mm_unpacklo_epi64(_mm_unpacklo_epi32(a, b), _mm_unpacklo_epi32(c, d));
+		}
+		if (mode == 2)
+		{
+			__m128i packed = _mm_loadl_epi64((const __m128i*)data);
+			__m128i mask = _mm_set1_epi8(15);
+			return _mm_unpacklo_epi64(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+		}
+		if (mode == 3)
+			return _mm_loadu_si128((const __m128i*)data);
+
+		return _mm_setzero_si128();
+	}
+
+	//Turns 16 differences back into values, returns the last one
+	unsigned char DecodeGroup(unsigned char* lane, const unsigned char* data, unsigned int mode, unsigned char previous)
+	{
+		__m128i values = UnpackGroup(data, mode);
+
+		__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1)));
+		values = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(127)), sign);
+
+		//Running sum of the 16 bytes in 4 steps
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 1));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 2));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 4));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 8));
+		values = _mm_add_epi8(values, _mm_set1_epi8((char)previous));
+
+		_mm_storeu_si128((__m128i*)lane, values);
+		return (unsigned char)(_mm_extract_epi16(values, 7) >> 8);
+	}
+
+	//lanes holds byte k of every vertex at lanes[k * BLOCK_VERTICES], written back as whole vertices
+	void Transpose(unsigned char* vertices, const unsigned char* lanes, size_t count, size_t stride)
+	{
+		for (size_t k = 0; k < stride; k += 4)
+		{
+			const unsigned char* lane0 = lanes + k * MeshCodec::BLOCK_VERTICES;
+			const unsigned char* lane1 = lane0 + MeshCodec::BLOCK_VERTICES;
+			const unsigned char* lane2 = lane1 + MeshCodec::BLOCK_VERTICES;
+			const unsigned char* lane3 = lane2 + MeshCodec::BLOCK_VERTICES;
+
+			size_t i = 0;
+			for (; i + GROUP_SIZE <= count; i += GROUP_SIZE)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(lane0 + i));
+				__m128i b = _mm_loadu_si128((const __m128i*)(lane1 + i));
+				__m128i c = _mm_loadu_si128((const __m128i*)(lane2 + i));
+				__m128i d = _mm_loadu_si128((const __m128i*)(lane3 + i));
+
+				__m128i abLow = _mm_unpacklo_epi8(a, b);
+				__m128i abHigh = _mm_unpackhi_epi8(a, b);
+				__m128i cdLow = _mm_unpacklo_epi8(c, d);
+				__m128i cdHigh = _mm_unpackhi_epi8(c, d);
+
+				//4 bytes of 4 vertices in each
+				__m128i quads[4] = { _mm_unpacklo_epi16(abLow, cdLow), _mm_unpackhi_epi16(abLow, cdLow),
+					_mm_unpacklo_epi16(abHigh, cdHigh), _mm_unpackhi_epi16(abHigh, cdHigh) };
+
+				unsigned char* vertex = vertices + i * stride + k;
+				for (size_t q = 0; q < 4; q++)
+				{
+					for (size_t j = 0; j < 4; j++)
+					{
+						int word = _mm_cvtsi128_si32(quads[q]);
+						memcpy(vertex, &word, sizeof(word));
+						vertex += stride;
+						quads[q] = _mm_srli_si128(quads[q], 4);
+					}
+				}
+			}
+
+			for (; i < count; i++)
+			{
+				unsigned char* vertex = vertices + i * stride + k;
+				vertex[0] = lane0[i];
+				vertex[1] = lane1[i];
+				vertex[2] = lane2[i];
+				vertex[3] = lane3[i];
+			}
+		}
+	}
+#else
+	unsigned char UnZigZag(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)-(value & 1));
+	}
+
+	unsigned char DecodeGroup(unsigned char* lane, const unsigned char* data, unsigned int mode, unsigned char previous)
+	{
+		unsigned char values[GROUP_SIZE];
+		for (size_t j = 0; j < GROUP_SIZE; j++)
+		{
+			if (mode == 1)
+				values[j] = (data[j & 3] >> ((j >> 2) * 2)) & 3;
+			else if (mode == 2)
+				values[j] = (data[j & 7] >> ((j >> 3) * 4)) & 15;
+			else if (mode == 3)
+				values[j] = data[j];
+			else
+				values[j] = 0;
+		}
+
+		for (size_t j = 0; j < GROUP_SIZE; j++)
+		{
+			previous = (unsigned char)(previous + UnZigZag(values[j]));
+			lane[j] = previous;
+		}
+		return previous;
+	}
+
+	void Transpose(unsigned char* vertices, const unsigned char* lanes, size_t count, size_t stride)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t k = 0; k < stride; k++)
+				vertices[i * stride + k] = lanes[k * MeshCodec::BLOCK_VERTICES + i];
+		}
+	}
+#endif
+
+	template<typename T>
+	bool DecodeIndexCodes(T* destination, size_t numOfIndices, const unsigned char* source, const unsigned char* end)
+	{
+		unsigned int next = 0, last = 0;
+		for (size_t i = 0; i < numOfIndices; i++)
+		{
+			if (source == end)
+				return false;
+
+			//Nearly every code fits in one byte
+			unsigned long long code = *source++;
+			if (code >= 0x80)
+			{
+				code &= 0x7F;
+				for (unsigned int shift = 7; ; shift += 7)
+				{
+					if (source == end || shift > 28)
+						return false;
+
+					unsigned char byte = *source++;
+					code |= (unsigned long long)(byte & 0x7F) << shift;
+					if (byte < 0x80)
+						break;
+				}
+			}
+
+			unsigned int index;
+			if (code == 0)
+				index = next;
+			else
+			{
+				unsigned int zigZag = (unsigned int)(code - 1);
+				index = last + ((zigZag >> 1) ^ (0u - (zigZag & 1)));
+			}
+
+			if (index >= next)
+				next = index + 1;
+			last = index;
+			destination[i] = (T)index;
+		}
+		return source == end;
+	}
+}
+
+bool MeshCodec::IsStrideSupported(size_t stride)
+{
+	return stride > 0 && stride <= MAX_STRIDE && stride % 4 == 0;
+}
+
+size_t MeshCodec::GetVertexBound(size_t numOfVertices, size_t stride)
+{
+	size_t blocks = (numOfVertices + BLOCK_VERTICES - 1) / BLOCK_VERTICES;
+	return 1 + blocks * stride * ((GROUPS_PER_BLOCK + 3) / 4 + GROUPS_PER_BLOCK * GROUP_SIZE);
+}
+
+size_t MeshCodec::EncodeVertices(unsigned char* destination, size_t destinationSize, const void* vertices, size_t numOfVertices, size_t stride)
+{
+	if (!IsStrideSupported(stride) || destinationSize < 1)
+		return 0;
+
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	unsigned char* output = destination;
+	unsigned char* end = destination + destinationSize;
+	*output++ = VERTEX_FORMAT;
+
+	//Each byte is compared with the same byte of the vertex before, across blocks too
+	unsigned char last[MAX_STRIDE] = {};
+	unsigned char deltas[BLOCK_VERTICES];
+
+	for (size_t first = 0; first < numOfVertices; first += BLOCK_VERTICES)
+	{
+		size_t count = numOfVertices - first < BLOCK_VERTICES ? numOfVertices - first : BLOCK_VERTICES;
+		size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+		size_t headerSize = (groups + 3) / 4;
+
+		for (size_t k = 0; k < stride; k++)
+		{
+			//The last group is padded with zero differences, which decode to copies of the last vertex
+			memset(deltas, 0, sizeof(deltas));
+			unsigned char previous = last[k];
+			for (size_t i = 0; i < count; i++)
+			{
+				unsigned char value = bytes[(first + i) * stride + k];
+				deltas[i] = ZigZag((unsigned char)(value - previous));
+				previous = value;
+			}
+			last[k] = previous;
+
+			if ((size_t)(end - output) < headerSize)
+				return 0;
+
+			unsigned char* header = output;
+			memset(header, 0, headerSize);
+			output += headerSize;
+
+			for (size_t g = 0; g < groups; g++)
+			{
+				const unsigned char* group = deltas + g * GROUP_SIZE;
+				unsigned char bits = 0;
+				for (size_t j = 0; j < GROUP_SIZE; j++)
+					bits |= group[j];
+
+				unsigned int mode = bits == 0 ? 0 : bits < 4 ? 1 : bits < 16 ? 2 : 3;
+				header[g / 4] |= (unsigned char)(mode << ((g % 4) * 2));
+
+				if ((size_t)(end - output) < PAYLOAD_SIZE[mode])
+					return 0;
+
+				EncodeGroup(output, group, mode);
+				output += PAYLOAD_SIZE[mode];
+			}
+		}
+	}
+
+	return output - destination;
+}
+
+bool MeshCodec::DecodeVertices(void* destination, size_t numOfVertices, size_t stride, const unsigned char* source, size_t sourceSize)
+{
+	if (!IsStrideSupported(stride) || sourceSize < 1 || source[0] != VERTEX_FORMAT)
+		return false;
+
+	const unsigned char* end = source + sourceSize;
+	source++;
+
+	unsigned char last[MAX_STRIDE] = {};
+	std::vector<unsigned char> lanes(stride * BLOCK_VERTICES);
+	unsigned char* vertices = (unsigned char*)destination;
+
+	for (size_t first = 0; first < numOfVertices; first += BLOCK_VERTICES)
+	{
+		size_t count = numOfVertices - first < BLOCK_VERTICES ? numOfVertices - first : BLOCK_VERTICES;
+		size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+		size_t headerSize = (groups + 3) / 4;
+
+		for (size_t k = 0; k < stride; k++)
+		{
+			if ((size_t)(end - source) < headerSize)
+				return false;
+
+			const unsigned char* header = source;
+			source += headerSize;
+
+			//One bounds check for the whole lane, the groups then read without any
+			size_t payloadSize = 0;
+			for (size_t g = 0; g < groups; g++)
+				payloadSize += PAYLOAD_SIZE[(header[g / 4] >> ((g % 4) * 2)) & 3];
+
+			if ((size_t)(end - source) < payloadSize)
+				return false;
+
+			unsigned char* lane = lanes.data() + k * BLOCK_VERTICES;
+			unsigned char previous = last[k];
+			for (size_t g = 0; g < groups; g++)
+			{
+				unsigned int mode = (header[g / 4] >> ((g % 4) * 2)) & 3;
+				previous = DecodeGroup(lane + g * GROUP_SIZE, source, mode, previous);
+				source += PAYLOAD_SIZE[mode];
+			}
+			last[k] = previous;
+		}
+
+		Transpose(vertices + first * stride, lanes.data(), count, stride);
+	}
+
+	return source == end;
+}
+
+size_t MeshCodec::GetIndexBound(size_t numOfIndices)
+{
+	//33 bit codes take 5 bytes at most
+	return 1 + numOfIndices * 5;
+}
+
+size_t MeshCodec::EncodeIndices(unsigned char* destination, size_t destinationSize, const unsigned int* indices, size_t numOfIndices)
+{
+	if (destinationSize < 1)
+		return 0;
+
+	unsigned char* output = destination;
+	unsigned char* end = destination + destinationSize;
+	*output++ = INDEX_FORMAT;
+
+	//next is the first vertex no index used yet, optimized meshes use their vertices in order
+	unsigned int next = 0, last = 0;
+	for (size_t i = 0; i < numOfIndices; i++)
+	{
+		unsigned int index = indices[i];
+
+		unsigned long long code = 0;
+		if (index != next)
+		{
+			unsigned int delta = index - last;
+			code = (unsigned long long)((delta << 1) ^ (0u - (delta >> 31))) + 1;
+		}
+
+		if (index >= next)
+			next = index + 1;
+		last = index;
+
+		do
+		{
+			if (output == end)
+				return 0;
+
+			unsigned char byte = (unsigned char)(code & 0x7F);
+			code >>= 7;
+			*output++ = code != 0 ? (unsigned char)(byte | 0x80) : byte;
+		} while (code != 0);
+	}
+
+	return output - destination;
+}
+
+bool MeshCodec::DecodeIndices(void* destination, GLenum type, size_t numOfIndices, const unsigned char* source, size_t sourceSize)
+{
+	if (sourceSize < 1 || source[0] != INDEX_FORMAT)
+		return false;
+
+	const unsigned char* end = source + sourceSize;
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:
+		return DecodeIndexCodes((GLubyte*)destination, numOfIndices, source + 1, end);
+	case GL_UNSIGNED_SHORT:
+		return DecodeIndexCodes((GLushort*)destination, numOfIndices, source + 1, end);
+	case GL_UNSIGNED_INT:
+		return DecodeIndexCodes((GLuint*)destination, numOfIndices, source + 1, end);
+	default:
+		return false;
+	}
+}
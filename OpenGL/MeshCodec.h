@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL\glew.h>
+
+/*
+Lossless compression of vertex and index buffers, in the spirit of meshoptimizer's codecs.
+
+Vertices are cut into blocks of BLOCK_VERTICES. Inside a block every byte of the vertex is stored on its own,
+as the difference with the same byte of the vertex before. After OPTIMIZE neighbouring vertices are close,
+so most differences are tiny: they are packed 16 at a time with 0, 2, 4 or 8 bits each.
+A group of 16 differences is decoded in one SSE2 register where available (see Simd.h).
+
+Indices are stored as variable length differences. After OPTIMIZE most indices are either the next vertex
+never used before (1 byte) or close to the previous index (1 byte).
+
+The output is usually 2-4 times smaller than the input and packs further with a general purpose compressor.
+*/
+namespace MeshCodec
+{
+	const size_t BLOCK_VERTICES = 256;
+	const size_t MAX_STRIDE = 256;
+
+	/*Vertices are encoded 4 bytes at a time, the stride has to be a multiple of 4 no larger than MAX_STRIDE*/
+	bool IsStrideSupported(size_t stride);
+
+	/**
+	* @return The most bytes EncodeVertices can write for these vertices
+	*/
+	size_t GetVertexBound(size_t numOfVertices, size_t stride);
+
+	/**
+	* Compresses vertices.
+	*
+	* @param stride Bytes of a vertex, see IsStrideSupported
+	* @return The number of bytes written, 0 when destination is too small or the stride is not supported
+	*/
+	size_t EncodeVertices(unsigned char* destination, size_t destinationSize, const void* vertices, size_t numOfVertices, size_t stride);
+
+	/**
+	* Decompresses vertices written by EncodeVertices, destination receives numOfVertices * stride bytes.
+	*
+	* @return false when the data is damaged
+	*/
+	bool DecodeVertices(void* destination, size_t numOfVertices, size_t stride, const unsigned char* source, size_t sourceSize);
+
+	/**
+	* @return The most bytes EncodeIndices can write for these indices
+	*/
+	size_t GetIndexBound(size_t numOfIndices);
+
+	/**
+	* Compresses indices.
+	*
+	* @return The number of bytes written, 0 when destination is too small
+	*/
+	size_t EncodeIndices(unsigned char* destination, size_t destinationSize, const unsigned int* indices, size_t numOfIndices);
+
+	/**
+	* Decompresses indices written by EncodeIndices, stored as type in destination.
+	*
+	* @param type GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, every index has to fit in it
+	* @return false when the data is damaged
+	*/
+	bool DecodeIndices(void* destination, GLenum type, size_t numOfIndices, const unsigned char* source, size_t sourceSize);
+}
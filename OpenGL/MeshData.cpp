@@ -0,0 +1,155 @@
+#include "MeshData.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "TangentSpace.h"
+
+MeshData::MeshData()
+{
+	numOfVertices = 0;
+	indexType = GL_UNSIGNED_INT;
+	numOfIndices = 0;
+
+	prepared = false;
+	cacheStatsBefore.acmr = cacheStatsBefore.atvr = 0.0f;
+	cacheStatsAfter = cacheStatsBefore;
+}
+
+void MeshData::SetStream(GLuint stream, const void* data)
+{
+	if (streams.size() < layout.GetStreamCount())
+		streams.resize(layout.GetStreamCount());
+
+	streams[stream].resize(layout.GetStreamSize(stream, numOfVertices));
+	memcpy(streams[stream].data(), data, streams[stream].size());
+}
+
+void MeshData::SetIndices(const unsigned int* data, unsigned int count)
+{
+	indexType = GL_UNSIGNED_INT;
+	numOfIndices = count;
+	indices.resize(sizeof(unsigned int) * count);
+	memcpy(indices.data(), data, indices.size());
+}
+
+bool MeshData::Prepare(unsigned int flags)
+{
+	if (prepared)
+		return true;
+
+	//Every pass below indexes per-vertex arrays with the indices, data from a damaged file must not get there
+	if (indices.size() != (size_t)IndexFormat::GetSize(indexType) * numOfIndices ||
+		!IndexFormat::CheckTriangles(indices.data(), indexType, numOfIndices, numOfVertices))
+	{
+		printf("Mesh data has indices outside of its %u vertices or not whole triangles!\n", numOfVertices);
+		Clear();
+		return false;
+	}
+
+	//New streams first, so the passes below reorder them along with the others
+	if (flags & MeshFlags::GENERATE_TANGENTS)
+		TangentSpace::AddTangents(*this);
+	else if (flags & MeshFlags::GENERATE_NORMALS)
+		TangentSpace::AddNormals(*this);
+
+	//The passes below work on 32 bit indices, they are narrowed again at the end
+	std::vector<unsigned int> unpacked(numOfIndices);
+	for (unsigned int i = 0; i < numOfIndices; i++)
+		unpacked[i] = IndexFormat::Read(indices.data(), indexType, i);
+
+	if (flags & MeshFlags::OPTIMIZE)
+	{
+		std::vector<unsigned int> optimizedIndices(numOfIndices);
+		cacheStatsBefore = MeshOptimizer::AnalyzeVertexCache(unpacked.data(), numOfIndices, numOfVertices);
+
+		//Triangle order first, the overdraw pass only moves whole clusters of it around
+		MeshOptimizer::OptimizeVertexCache(optimizedIndices.data(), unpacked.data(), numOfIndices, numOfVertices);
+
+		GLsizei positionStride = 0;
+		std::vector<const void*> streamData = GetStreamPointers();
+		const float* positions = layout.FindPositions(streamData.data(), positionStride);
+		if (positions != nullptr)
+			MeshOptimizer::OptimizeOverdraw(optimizedIndices.data(), numOfIndices, positions, positionStride, numOfVertices);
+
+		cacheStatsAfter = MeshOptimizer::AnalyzeVertexCache(optimizedIndices.data(), numOfIndices, numOfVertices);
+
+		//Then the vertices follow the new triangle order, in every stream
+		//The remap is kept for data that follows the vertices outside of the streams (see MorphTargets)
+		unsigned int optimizedVertexCount = (unsigned int)MeshOptimizer::OptimizeVertexFetch(vertexRemap, optimizedIndices.data(), numOfIndices, numOfVertices);
+
+		for (GLuint i = 0; i < layout.GetStreamCount(); i++)
+		{
+			std::vector<unsigned char> optimizedStream(layout.GetStreamSize(i, optimizedVertexCount));
+			MeshOptimizer::RemapVertices(optimizedStream.data(), streams[i].data(), numOfVertices, layout.GetStride(i), vertexRemap);
+			streams[i].swap(optimizedStream);
+		}
+
+		numOfVertices = optimizedVertexCount;
+		unpacked.swap(optimizedIndices);
+	}
+
+	GLsizei positionStride = 0;
+	std::vector<const void*> streamData = GetStreamPointers();
+	const float* positions = layout.FindPositions(streamData.data(), positionStride);
+	bounds = Bounds::FromPositions(positions, positionStride, numOfVertices);
+
+	if (flags & MeshFlags::BUILD_MESHLETS)
+	{
+		if (positions != nullptr)
+			meshlets = MeshletBuilder::Build(unpacked.data(), numOfIndices, positions, positionStride, numOfVertices);
+		else
+			printf("Meshlets need positions stored as 3 floats, the mesh will be drawn whole!\n");
+	}
+
+	//Every level goes in the same index buffer, after the full detail indices
+	if (flags & MeshFlags::BUILD_LODS)
+	{
+		if (positions != nullptr)
+		{
+			std::vector<unsigned int> chainIndices;
+			MeshSimplifier::BuildLODChain(unpacked.data(), numOfIndices, positions, positionStride, numOfVertices, chainIndices, lodLevels);
+			unpacked.swap(chainIndices);
+		}
+		else
+		{
+			printf("Levels of detail need positions stored as 3 floats, the mesh will be drawn whole!\n");
+		}
+	}
+
+	//Most meshes have less than 65536 vertices, so their indices fit in half the memory
+	indexType = IndexFormat::ChooseType(unpacked.data(), unpacked.size(), (flags & MeshFlags::BYTE_INDICES) != 0);
+	indices.resize(IndexFormat::GetSize(indexType) * unpacked.size());
+	IndexFormat::Narrow(unpacked.data(), unpacked.size(), indexType, indices.data());
+
+	prepared = true;
+	return true;
+}
+
+std::vector<const void*> MeshData::GetStreamPointers() const
+{
+	std::vector<const void*> pointers(streams.size());
+	for (size_t i = 0; i < streams.size(); i++)
+		pointers[i] = streams[i].data();
+	return pointers;
+}
+
+size_t MeshData::GetByteSize() const
+{
+	size_t bytes = indices.size();
+	for (size_t i = 0; i < streams.size(); i++)
+		bytes += streams[i].size();
+	return bytes;
+}
+
+void MeshData::Clear()
+{
+	//swap, so the memory is really given back
+	std::vector<std::vector<unsigned char> >().swap(streams);
+	std::vector<unsigned char>().swap(indices);
+	std::vector<Meshlet>().swap(meshlets);
+	std::vector<LODLevel>().swap(lodLevels);
+	std::vector<unsigned int>().swap(vertexRemap);
+	numOfVertices = 0;
+	numOfIndices = 0;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "IndexFormat.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+
+/*
+Flags for Mesh::CreateMesh and MeshData::Prepare, reached as Mesh::OPTIMIZE and so on.
+They live here so the tools preparing meshes offline (MeshCooker) do not depend on Mesh and OpenGL.
+*/
+struct MeshFlags
+{
+	//Reuse the buffers of an identical mesh instead of uploading the data again (see GeometryCache)
+	static const unsigned int SHARE_GEOMETRY = 1 << 0;
+	//Let indices be stored as GL_UNSIGNED_BYTE when they fit, see IndexFormat::ChooseType before using it
+	static const unsigned int BYTE_INDICES = 1 << 1;
+	//Reorder triangles and vertices for the vertex cache, overdraw and vertex fetch (see MeshOptimizer)
+	static const unsigned int OPTIMIZE = 1 << 2;
+	//Split the mesh into meshlets, so RenderMeshClusters can skip the ones that can not be seen
+	static const unsigned int BUILD_MESHLETS = 1 << 3;
+	//Generate simplified levels of detail, so RenderMeshLOD can draw fewer triangles far from the camera
+	static const unsigned int BUILD_LODS = 1 << 4;
+	//Compute smooth normals when the mesh has none (see TangentSpace)
+	static const unsigned int GENERATE_NORMALS = 1 << 5;
+	//Compute tangents for normal mapping when the mesh has none, and normals first if needed (see TangentSpace)
+	static const unsigned int GENERATE_TANGENTS = 1 << 6;
+
+	//The buffers are updated often (see Mesh::UpdateVertices), stored as GL_DYNAMIC_DRAW. Such meshes never share their geometry
+	static const unsigned int DYNAMIC_DRAW = 1 << 7;
+	//The buffers are rewritten about every frame, stored as GL_STREAM_DRAW. Such meshes never share their geometry
+	static const unsigned int STREAM_DRAW = 1 << 8;
+};
+
+/*
+Everything a Mesh is made of, kept in memory instead of on the GPU.
+It needs no OpenGL context, so it can be filled and prepared on any thread (see Prepare)
+and uploaded later with Mesh::CreateMesh or a MeshUploader.
+*/
+struct MeshData
+{
+	VertexLayout layout;
+	std::vector<std::vector<unsigned char> > streams;	//vertex data of each stream of the layout
+	unsigned int numOfVertices;
+
+	std::vector<unsigned char> indices;		//stored as indexType, after preparing the LOD chain follows the full detail indices
+	GLenum indexType;
+	unsigned int numOfIndices;				//indices of the full detail mesh
+
+	//Filled by Prepare
+	bool prepared;
+	MeshOptimizer::CacheStats cacheStatsBefore, cacheStatsAfter;
+	std::vector<Meshlet> meshlets;
+	std::vector<LODLevel> lodLevels;
+	Bounds bounds;		//around the positions, empty when they are not stored as 3 floats
+	std::vector<unsigned int> vertexRemap;	//after OPTIMIZE, the new position of every vertex given (~0u when dropped), empty otherwise
+
+	MeshData();
+
+	/**
+	* Copies the vertices of one stream, layout.GetStreamSize(stream, numOfVertices) bytes.
+	* The layout and numOfVertices have to be set first.
+	*/
+	void SetStream(GLuint stream, const void* data);
+
+	/**
+	* Copies indices, stored as GL_UNSIGNED_INT until the mesh is prepared.
+	*/
+	void SetIndices(const unsigned int* data, unsigned int count);
+
+	/**
+	* Runs the CPU passes of the Mesh flags (GENERATE_NORMALS or GENERATE_TANGENTS, OPTIMIZE, BUILD_MESHLETS, BUILD_LODS, then index narrowing),
+	* computes the bounds and marks the data prepared. Does not touch OpenGL, so it can run on any thread or in a tool.
+	*
+	* @param flags The Mesh flags the mesh will be created with
+	* @return false when the indices are not whole triangles or point past the vertices, the data is then cleared
+	*/
+	bool Prepare(unsigned int flags);
+
+	/*The data of each stream, the way CreateMesh takes it*/
+	std::vector<const void*> GetStreamPointers() const;
+
+	/*Indices stored, the LOD chain included*/
+	unsigned int GetTotalIndexCount() const { return (unsigned int)(indices.size() / IndexFormat::GetSize(indexType)); }
+
+	/*Bytes that have to go to the GPU*/
+	size_t GetByteSize() const;
+
+	/*Frees the memory once the mesh is on the GPU*/
+	void Clear();
+};
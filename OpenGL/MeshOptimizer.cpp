@@ -0,0 +1,317 @@
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	//Tuning values from Tom Forsyth's article, the cache is modelled as LRU of 32 vertices
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float VertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		//No triangle left to draw with this vertex, it does not matter anymore
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			//The 3 vertices of the last triangle get a fixed score, so the next triangle does not just reuse 2 of them
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE;
+			else
+				score = powf(1.0f - (float)(cachePosition - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+
+		//Vertices with few triangles left get a boost, so they are finished off instead of left behind
+		score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	glm::vec3 GetPosition(const float* positions, size_t positionStride, unsigned int vertex)
+	{
+		const float* position = (const float*)((const char*)positions + positionStride * vertex);
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t numOfIndices, size_t numOfVertices, unsigned int cacheSize)
+{
+	CacheStats stats = { 0.0f, 0.0f };
+	if (numOfIndices < 3 || numOfVertices == 0)
+		return stats;
+
+	//A vertex is still in the FIFO while less than cacheSize misses happened since it went in
+	std::vector<unsigned int> timestamps(numOfVertices, 0);
+	std::vector<bool> used(numOfVertices, false);
+	unsigned int time = cacheSize + 1;
+	size_t misses = 0, usedVertices = 0;
+
+	for (size_t i = 0; i < numOfIndices; i++)
+	{
+		unsigned int vertex = indices[i];
+
+		if (time - timestamps[vertex] > cacheSize)
+		{
+			timestamps[vertex] = time++;
+			misses++;
+		}
+
+		if (!used[vertex])
+		{
+			used[vertex] = true;
+			usedVertices++;
+		}
+	}
+
+	stats.acmr = (float)misses / (numOfIndices / 3);
+	stats.atvr = (float)misses / usedVertices;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t numOfIndices, size_t numOfVertices)
+{
+	size_t numOfTriangles = numOfIndices / 3;
+
+	//Triangles using each vertex, packed in one array (adjacencyOffsets[v] is where the list of v starts)
+	std::vector<unsigned int> remainingTriangles(numOfVertices, 0);
+	for (size_t i = 0; i < numOfTriangles * 3; i++)
+		remainingTriangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyOffsets(numOfVertices + 1, 0);
+	for (size_t v = 0; v < numOfVertices; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+
+	std::vector<unsigned int> adjacency(numOfTriangles * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+	}
+
+	std::vector<int> cachePositions(numOfVertices, -1);
+	std::vector<float> vertexScores(numOfVertices);
+	for (size_t v = 0; v < numOfVertices; v++)
+		vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+
+	std::vector<float> triangleScores(numOfTriangles);
+	std::vector<bool> emitted(numOfTriangles, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > bestScore)
+		{
+			bestScore = triangleScores[t];
+			bestTriangle = (int)t;
+		}
+	}
+
+	std::vector<unsigned int> cache, newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+	size_t nextInputTriangle = 0;
+
+	for (size_t output = 0; output < numOfTriangles; output++)
+	{
+		//Nothing in the cache can continue the strip, starting again from the next triangle in input order
+		if (bestTriangle < 0)
+		{
+			while (emitted[nextInputTriangle])
+				nextInputTriangle++;
+			bestTriangle = (int)nextInputTriangle;
+		}
+
+		const unsigned int* triangle = indices + bestTriangle * 3;
+		memcpy(destination + output * 3, triangle, sizeof(unsigned int) * 3);
+		emitted[bestTriangle] = true;
+
+		//Taking the triangle out of the lists of its vertices
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int vertex = triangle[k];
+			unsigned int* list = &adjacency[adjacencyOffsets[vertex]];
+			unsigned int count = remainingTriangles[vertex];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (list[i] == (unsigned int)bestTriangle)
+				{
+					list[i] = list[count - 1];
+					break;
+				}
+			}
+			remainingTriangles[vertex]--;
+		}
+
+		//The triangle vertices go to the front of the LRU cache, the others move back
+		newCache.clear();
+		newCache.push_back(triangle[0]);
+		newCache.push_back(triangle[1]);
+		newCache.push_back(triangle[2]);
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int vertex = cache[i];
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				newCache.push_back(vertex);
+		}
+
+		//Updating the scores of every vertex whose cache position changed, and of their triangles
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			unsigned int vertex = newCache[i];
+			int position = i < (size_t)CACHE_SIZE ? (int)i : -1;
+			cachePositions[vertex] = position;
+
+			float score = VertexScore(position, remainingTriangles[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			const unsigned int* list = &adjacency[adjacencyOffsets[vertex]];
+			for (unsigned int j = 0; j < remainingTriangles[vertex]; j++)
+			{
+				unsigned int t = list[j];
+				triangleScores[t] += delta;
+
+				//Only triangles touching the cache are candidates for the next one
+				if (position >= 0 && triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		if (newCache.size() > (size_t)CACHE_SIZE)
+			newCache.resize(CACHE_SIZE);
+		cache.swap(newCache);
+	}
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices)
+{
+	size_t numOfTriangles = numOfIndices / 3;
+	if (numOfTriangles == 0)
+		return;
+
+	//A new cluster starts where all 3 vertices miss the cache, moving clusters around can not make the cache worse there
+	std::vector<size_t> clusterStarts;
+	std::vector<unsigned int> timestamps(numOfVertices, 0);
+	unsigned int time = ANALYZE_CACHE_SIZE + 1;
+
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int vertex = indices[t * 3 + k];
+			if (time - timestamps[vertex] > ANALYZE_CACHE_SIZE)
+			{
+				timestamps[vertex] = time++;
+				misses++;
+			}
+		}
+
+		if (t == 0 || misses == 3)
+			clusterStarts.push_back(t);
+	}
+	clusterStarts.push_back(numOfTriangles);
+
+	size_t numOfClusters = clusterStarts.size() - 1;
+
+	//Area weighted centre and normal of every cluster, and the centre of the whole mesh
+	std::vector<glm::vec3> clusterCentres(numOfClusters), clusterNormals(numOfClusters);
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < numOfClusters; c++)
+	{
+		glm::vec3 centre(0.0f), normal(0.0f);
+		float area = 0.0f;
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			glm::vec3 a = GetPosition(positions, positionStride, indices[t * 3]);
+			glm::vec3 b = GetPosition(positions, positionStride, indices[t * 3 + 1]);
+			glm::vec3 d = GetPosition(positions, positionStride, indices[t * 3 + 2]);
+
+			//The cross product is twice the area, pointing along the triangle normal
+			glm::vec3 cross = glm::cross(b - a, d - a);
+			float triangleArea = glm::length(cross);
+
+			centre += (a + b + d) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentre += centre;
+		meshArea += area;
+
+		clusterCentres[c] = area > 0.0f ? centre / area : GetPosition(positions, positionStride, indices[clusterStarts[c] * 3]);
+		float normalLength = glm::length(normal);
+		clusterNormals[c] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+	}
+
+	if (meshArea > 0.0f)
+		meshCentre /= meshArea;
+
+	//Clusters facing outwards the most are drawn first
+	std::vector<float> sortKeys(numOfClusters);
+	std::vector<size_t> order(numOfClusters);
+	for (size_t c = 0; c < numOfClusters; c++)
+	{
+		sortKeys[c] = glm::dot(clusterCentres[c] - meshCentre, clusterNormals[c]);
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> sorted;
+	sorted.reserve(numOfTriangles * 3);
+	for (size_t i = 0; i < numOfClusters; i++)
+	{
+		size_t c = order[i];
+		sorted.insert(sorted.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+	}
+
+	memcpy(indices, sorted.data(), sizeof(unsigned int) * sorted.size());
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<unsigned int>& remap, unsigned int* indices, size_t numOfIndices, size_t numOfVertices)
+{
+	remap.assign(numOfVertices, ~0u);
+	unsigned int nextVertex = 0;
+
+	//Vertices are numbered in the order the triangles first use them
+	for (size_t i = 0; i < numOfIndices; i++)
+	{
+		unsigned int vertex = indices[i];
+		if (remap[vertex] == ~0u)
+			remap[vertex] = nextVertex++;
+
+		indices[i] = remap[vertex];
+	}
+
+	return nextVertex;
+}
+
+void MeshOptimizer::RemapVertices(void* destination, const void* vertices, size_t numOfVertices, size_t stride, const std::vector<unsigned int>& remap)
+{
+	for (size_t v = 0; v < numOfVertices; v++)
+	{
+		if (remap[v] == ~0u)
+			continue;
+
+		memcpy((char*)destination + stride * remap[v], (const char*)vertices + stride * v, stride);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+/*
+Reordering of triangles and vertices so the GPU does less work drawing the same mesh.
+
+The GPU keeps the last transformed vertices in a small post-transform cache, a triangle reusing them does not run
+the vertex shader again. Triangles sorted so neighbours follow each other hit that cache much more often.
+Vertices sorted in the order the triangles first use them make the vertex fetch read memory linearly.
+
+Typical use, in this order:
+	OptimizeVertexCache -> OptimizeOverdraw -> OptimizeVertexFetch + RemapVertices
+*/
+namespace MeshOptimizer
+{
+	struct CacheStats
+	{
+		float acmr;		//average cache miss ratio, vertex shader runs per triangle (0.5 is ideal, 3 is the worst)
+		float atvr;		//average transformed vertex ratio, vertex shader runs per vertex (1 is ideal)
+	};
+
+	//Cache size used to measure the stats, a usual size for current GPUs
+	const unsigned int ANALYZE_CACHE_SIZE = 16;
+
+	/**
+	* Simulates a FIFO post-transform cache over the triangle list.
+	*/
+	CacheStats AnalyzeVertexCache(const unsigned int* indices, size_t numOfIndices, size_t numOfVertices, unsigned int cacheSize = ANALYZE_CACHE_SIZE);
+
+	/**
+	* Sorts the triangles for post-transform cache locality (Tom Forsyth's linear-speed vertex cache optimisation).
+	*
+	* @param destination Receives the sorted indices, numOfIndices of them. Must not be the same array as indices
+	*/
+	void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t numOfIndices, size_t numOfVertices);
+
+	/**
+	* Sorts clusters of triangles so the ones facing away from the centre of the mesh are drawn first,
+	* they are more likely to hide the others and the fragment shader runs less often (Sander et al., Tipsify).
+	* Clusters are cut where the cache would start cold anyway, so the cache order is kept.
+	*
+	* @param indices The indices to sort in place, best already sorted with OptimizeVertexCache
+	* @param positions Position of the first vertex, 3 floats
+	* @param positionStride Bytes from one position to the next
+	*/
+	void OptimizeOverdraw(unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices);
+
+	/**
+	* Builds the vertex order that follows the triangles and rewrites the indices to use it.
+	* Vertices that no triangle uses are dropped.
+	*
+	* @param remap Receives the new position of every old vertex (~0u for dropped vertices)
+	* @return The number of vertices left
+	*/
+	size_t OptimizeVertexFetch(std::vector<unsigned int>& remap, unsigned int* indices, size_t numOfIndices, size_t numOfVertices);
+
+	/**
+	* Moves the vertices of one stream to their new positions.
+	*
+	* @param destination Receives the vertices, must hold as many as OptimizeVertexFetch returned
+	* @param stride Bytes taken by one vertex of the stream
+	*/
+	void RemapVertices(void* destination, const void* vertices, size_t numOfVertices, size_t stride, const std::vector<unsigned int>& remap);
+}
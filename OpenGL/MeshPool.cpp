@@ -0,0 +1,164 @@
+#include "MeshPool.h"
+
+#include <utility>
+
+#include "GlbModel.h"
+
+MeshPool::MeshPool()
+{
+}
+
+void MeshPool::Reserve(size_t count)
+{
+	meshes.reserve(count);
+	meshSlots.reserve(count);
+	slots.reserve(count);
+}
+
+MeshPool::Handle MeshPool::Create()
+{
+	return Add(Mesh());
+}
+
+MeshPool::Handle MeshPool::Add(Mesh&& mesh)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (slots.size() >= MAX_MESHES)
+		{
+			printf("Mesh pool is full!\n");
+			return INVALID_HANDLE;
+		}
+
+		Slot newSlot;
+		newSlot.generation = 1;
+		slot = (unsigned int)slots.size();
+		slots.push_back(newSlot);
+	}
+
+	slots[slot].position = (unsigned int)meshes.size();
+	meshes.push_back(std::move(mesh));
+	meshSlots.push_back(slot);
+
+	return MakeHandle(slot);
+}
+
+MeshPool::Slot* MeshPool::FindSlot(Handle handle)
+{
+	unsigned int slot = handle & MAX_MESHES;
+	if (handle == INVALID_HANDLE || slot >= slots.size())
+		return nullptr;
+
+	//A free slot has already moved to the next generation, so old handles never match it
+	if (slots[slot].generation != handle >> INDEX_BITS)
+		return nullptr;
+
+	return &slots[slot];
+}
+
+void MeshPool::CreateFromGlb(GlbModel& model, std::vector<Handle>& handles, unsigned int flags)
+{
+	bool cpuPasses = (flags & (Mesh::OPTIMIZE | Mesh::BUILD_MESHLETS | Mesh::BUILD_LODS | Mesh::GENERATE_NORMALS | Mesh::GENERATE_TANGENTS)) != 0;
+	const std::vector<GlbModel::Primitive>& primitives = model.GetPrimitives();
+
+	handles.clear();
+	handles.reserve(primitives.size());
+	Reserve(meshes.size() + primitives.size());
+
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		Handle handle = Create();
+		handles.push_back(handle);
+
+		if (cpuPasses)
+		{
+			//The passes reorder the data, so it has to be copied out of the file first
+			MeshData data;
+			model.GetMeshData(i, data);
+			Get(handle)->CreateMesh(data, flags);
+		}
+		else
+		{
+			const GlbModel::Primitive& primitive = primitives[i];
+			Get(handle)->CreateMesh(primitive.layout, primitive.streams.data(), primitive.numOfVertices,
+				primitive.indices, primitive.indexType, primitive.numOfIndices, flags);
+		}
+	}
+}
+
+Mesh* MeshPool::Get(Handle handle)
+{
+	Slot* slot = FindSlot(handle);
+	return slot != nullptr ? &meshes[slot->position] : nullptr;
+}
+
+bool MeshPool::IsValid(Handle handle)
+{
+	return FindSlot(handle) != nullptr;
+}
+
+unsigned int MeshPool::NextGeneration(unsigned int generation)
+{
+	//Wraps around, skipping 0 so no handle is ever 0
+	generation = (generation + 1) & ((1u << GENERATION_BITS) - 1);
+	return generation == 0 ? 1 : generation;
+}
+
+void MeshPool::Release(Handle handle)
+{
+	Slot* slot = FindSlot(handle);
+	if (slot == nullptr)
+		return;
+
+	unsigned int position = slot->position;
+	unsigned int last = (unsigned int)meshes.size() - 1;
+
+	//The last mesh fills the hole, moving into the mesh clears it from the GPU first
+	if (position != last)
+	{
+		meshes[position] = std::move(meshes[last]);
+		meshSlots[position] = meshSlots[last];
+		slots[meshSlots[position]].position = position;
+	}
+	meshes.pop_back();
+	meshSlots.pop_back();
+
+	unsigned int index = handle & MAX_MESHES;
+	slots[index].generation = NextGeneration(slots[index].generation);
+	freeSlots.push_back(index);
+}
+
+void MeshPool::Release(const Handle* handles, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		Release(handles[i]);
+}
+
+void MeshPool::ReleaseAll()
+{
+	meshes.clear();
+
+	for (size_t i = 0; i < meshSlots.size(); i++)
+	{
+		unsigned int slot = meshSlots[i];
+		slots[slot].generation = NextGeneration(slots[slot].generation);
+		freeSlots.push_back(slot);
+	}
+	meshSlots.clear();
+}
+
+MeshPool::Handle MeshPool::GetHandle(size_t position)
+{
+	return position < meshSlots.size() ? MakeHandle(meshSlots[position]) : INVALID_HANDLE;
+}
+
+MeshPool::~MeshPool()
+{
+	ReleaseAll();
+}
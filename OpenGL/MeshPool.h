@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "Mesh.h"
+
+class GlbModel;
+
+/*
+Owns meshes and hands out handles to them instead of pointers.
+
+The meshes are stored next to each other in one array with no gaps, so drawing every live mesh is a linear walk
+through memory (GetMeshes, GetCount) and creating a mesh allocates nothing once the pool has grown.
+Releasing a mesh moves the last one into its place.
+
+A handle is 32 bits: the slot of the mesh in the low INDEX_BITS, and the generation of the slot above them.
+The generation changes every time the slot is released, so a handle to a released mesh stays invalid
+even after the slot holds another mesh. 0 is never a valid handle.
+
+Pointers returned by Get and GetMeshes are only valid until the next Create, Add or Release, do not keep them
+(give a MeshUploader the handle instead).
+*/
+class MeshPool
+{
+public:
+	typedef unsigned int Handle;
+
+	static const Handle INVALID_HANDLE = 0;
+	static const unsigned int INDEX_BITS = 20;
+	static const unsigned int GENERATION_BITS = 32 - INDEX_BITS;
+	static const unsigned int MAX_MESHES = (1u << INDEX_BITS) - 1;
+
+	MeshPool();
+
+	/**
+	* Makes room for a number of meshes, so creating them does not grow the arrays.
+	*/
+	void Reserve(size_t count);
+
+	/**
+	* Creates an empty mesh, to be filled with one of the CreateMesh functions of Get(handle).
+	*
+	* @return The handle of the mesh, INVALID_HANDLE when the pool is full
+	*/
+	Handle Create();
+
+	/**
+	* Moves an existing mesh into the pool, mesh is left empty.
+	*/
+	Handle Add(Mesh&& mesh);
+
+	/**
+	* Creates one mesh for every primitive of a glb model, in the order of GlbModel::GetPrimitives.
+	* Without CPU passes in flags (OPTIMIZE, BUILD_MESHLETS, BUILD_LODS, GENERATE_NORMALS, GENERATE_TANGENTS) the data is uploaded without any copy.
+	*
+	* @param handles Receives the handle of each primitive mesh
+	*/
+	void CreateFromGlb(GlbModel& model, std::vector<Handle>& handles, unsigned int flags = 0);
+
+	/**
+	* @return The mesh, nullptr when the handle has been released
+	*/
+	Mesh* Get(Handle handle);
+
+	bool IsValid(Handle handle);
+
+	/**
+	* Clears the mesh from the GPU and frees its handle. Released handles are ignored.
+	*/
+	void Release(Handle handle);
+
+	/**
+	* Releases many meshes at once.
+	*/
+	void Release(const Handle* handles, size_t count);
+
+	/**
+	* Releases every mesh of the pool, every handle given so far becomes invalid.
+	*/
+	void ReleaseAll();
+
+	/*The live meshes, one after the other*/
+	Mesh* GetMeshes() { return meshes.data(); }
+	size_t GetCount() { return meshes.size(); }
+
+	/*The handle of the mesh at a position of GetMeshes*/
+	Handle GetHandle(size_t position);
+
+	~MeshPool();
+
+private:
+	struct Slot
+	{
+		unsigned int position;		//where the mesh is in meshes
+		unsigned int generation;
+	};
+
+	std::vector<Mesh> meshes;
+	std::vector<unsigned int> meshSlots;	//slot of each mesh, to fix the slot of the mesh moved by Release
+	std::vector<Slot> slots;
+	std::vector<unsigned int> freeSlots;
+
+	Handle MakeHandle(unsigned int slot) { return (slots[slot].generation << INDEX_BITS) | slot; }
+	Slot* FindSlot(Handle handle);
+	unsigned int NextGeneration(unsigned int generation);
+};
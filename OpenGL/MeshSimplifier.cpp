@@ -0,0 +1,357 @@
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "MeshOptimizer.h"
+
+namespace
+{
+	//Symmetric 4x4 matrix summing the squared distance to a set of planes, plus the total weight of the planes
+	struct Quadric
+	{
+		double a00, a01, a02, a03;
+		double a11, a12, a13;
+		double a22, a23;
+		double a33;
+		double weight;
+	};
+
+	void AddPlane(Quadric& q, const glm::dvec3& normal, double d, double weight)
+	{
+		q.a00 += weight * normal.x * normal.x;
+		q.a01 += weight * normal.x * normal.y;
+		q.a02 += weight * normal.x * normal.z;
+		q.a03 += weight * normal.x * d;
+		q.a11 += weight * normal.y * normal.y;
+		q.a12 += weight * normal.y * normal.z;
+		q.a13 += weight * normal.y * d;
+		q.a22 += weight * normal.z * normal.z;
+		q.a23 += weight * normal.z * d;
+		q.a33 += weight * d * d;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02; q.a03 += other.a03;
+		q.a11 += other.a11; q.a12 += other.a12; q.a13 += other.a13;
+		q.a22 += other.a22; q.a23 += other.a23;
+		q.a33 += other.a33;
+		q.weight += other.weight;
+	}
+
+	//Weighted sum of squared distances from p to the planes
+	double Evaluate(const Quadric& q, const glm::dvec3& p)
+	{
+		double result = q.a00 * p.x * p.x + 2.0 * q.a01 * p.x * p.y + 2.0 * q.a02 * p.x * p.z + 2.0 * q.a03 * p.x
+			+ q.a11 * p.y * p.y + 2.0 * q.a12 * p.y * p.z + 2.0 * q.a13 * p.y
+			+ q.a22 * p.z * p.z + 2.0 * q.a23 * p.z
+			+ q.a33;
+		return result > 0.0 ? result : 0.0;
+	}
+
+	struct Collapse
+	{
+		float error;
+		unsigned int from, to;
+		unsigned int fromVersion, toVersion;
+
+		bool operator>(const Collapse& other) const { return error > other.error; }
+	};
+
+	glm::dvec3 GetPosition(const float* positions, size_t positionStride, unsigned int vertex)
+	{
+		const float* position = (const float*)((const char*)positions + positionStride * vertex);
+		return glm::dvec3(position[0], position[1], position[2]);
+	}
+}
+
+size_t MeshSimplifier::Simplify(unsigned int* destination, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+	size_t numOfVertices, size_t targetIndexCount, float targetError, float* resultError)
+{
+	size_t numOfTriangles = numOfIndices / 3;
+	if (resultError != nullptr)
+		*resultError = 0.0f;
+
+	std::vector<unsigned int> triangles(indices, indices + numOfTriangles * 3);
+	std::vector<bool> triangleAlive(numOfTriangles, true);
+
+	//Vertices sharing a position (split for another normal or uv) are the same point of the surface
+	//Sorting by position puts them next to each other, the first one of each run stands for the point
+	std::vector<unsigned int> sortedVertices(numOfVertices);
+	for (size_t v = 0; v < numOfVertices; v++)
+		sortedVertices[v] = (unsigned int)v;
+
+	auto positionOf = [positions, positionStride](unsigned int v) { return (const float*)((const char*)positions + positionStride * v); };
+	//By bytes, as the points are matched below: a NaN compared as a float would break the ordering std::sort needs
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&positionOf](unsigned int a, unsigned int b)
+	{
+		return memcmp(positionOf(a), positionOf(b), sizeof(float) * 3) < 0;
+	});
+
+	std::vector<unsigned int> pointOf(numOfVertices);
+	for (size_t i = 0; i < numOfVertices; i++)
+	{
+		unsigned int v = sortedVertices[i];
+		if (i > 0 && memcmp(positionOf(v), positionOf(sortedVertices[i - 1]), sizeof(float) * 3) == 0)
+			pointOf[v] = pointOf[sortedVertices[i - 1]];
+		else
+			pointOf[v] = v;
+	}
+
+	std::vector<unsigned int> vertexCopies(numOfVertices, 0);
+	for (size_t v = 0; v < numOfVertices; v++)
+		vertexCopies[pointOf[v]]++;
+
+	//Counting in how many triangles each edge is, an edge in only one triangle is on a border
+	std::unordered_map<unsigned long long, unsigned int> edgeUses;
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = pointOf[triangles[t * 3 + k]];
+			unsigned int b = pointOf[triangles[t * 3 + (k + 1) % 3]];
+			if (a > b)
+				std::swap(a, b);
+			edgeUses[((unsigned long long)a << 32) | b]++;
+		}
+	}
+
+	//Border vertices and vertices on seams between copies never move, so the outline and the attributes stay put
+	std::vector<bool> locked(numOfVertices, false);
+	for (size_t v = 0; v < numOfVertices; v++)
+		locked[v] = vertexCopies[pointOf[v]] > 1;
+
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int va = triangles[t * 3 + k], vb = triangles[t * 3 + (k + 1) % 3];
+			unsigned int a = pointOf[va], b = pointOf[vb];
+			if (a > b)
+				std::swap(a, b);
+			if (edgeUses[((unsigned long long)a << 32) | b] != 2)
+			{
+				locked[va] = true;
+				locked[vb] = true;
+			}
+		}
+	}
+
+	//Every vertex starts with the planes of its triangles, weighted by their area
+	Quadric zero;
+	memset(&zero, 0, sizeof(zero));
+	std::vector<Quadric> quadrics(numOfVertices, zero);
+	std::vector<std::vector<unsigned int> > vertexTriangles(numOfVertices);
+
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		glm::dvec3 a = GetPosition(positions, positionStride, triangles[t * 3]);
+		glm::dvec3 b = GetPosition(positions, positionStride, triangles[t * 3 + 1]);
+		glm::dvec3 c = GetPosition(positions, positionStride, triangles[t * 3 + 2]);
+
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double area = glm::length(normal);
+
+		for (int k = 0; k < 3; k++)
+			vertexTriangles[triangles[t * 3 + k]].push_back((unsigned int)t);
+
+		if (area == 0.0)
+			continue;
+
+		normal /= area;
+		double d = -glm::dot(normal, a);
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[triangles[t * 3 + k]], normal, d, area * 0.5);
+	}
+
+	std::vector<unsigned int> versions(numOfVertices, 0);
+	std::vector<bool> vertexAlive(numOfVertices, true);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > queue;
+
+	//Error of moving from onto to, as a distance: the area weighted RMS distance to the planes of both vertices
+	auto pushCollapse = [&](unsigned int from, unsigned int to)
+	{
+		if (locked[from] || from == to)
+			return;
+
+		Quadric q = quadrics[from];
+		AddQuadric(q, quadrics[to]);
+
+		Collapse collapse;
+		collapse.error = q.weight > 0.0 ? (float)sqrt(Evaluate(q, GetPosition(positions, positionStride, to)) / q.weight) : 0.0f;
+		collapse.from = from;
+		collapse.to = to;
+		collapse.fromVersion = versions[from];
+		collapse.toVersion = versions[to];
+		queue.push(collapse);
+	};
+
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	size_t indexCount = numOfTriangles * 3;
+	float maxError = 0.0f;
+
+	while (indexCount > targetIndexCount && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		//Either vertex changed since this collapse was measured, a newer entry exists for it
+		if (!vertexAlive[collapse.from] || !vertexAlive[collapse.to] ||
+			versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+			continue;
+
+		if (collapse.error > targetError)
+			break;
+
+		unsigned int from = collapse.from, to = collapse.to;
+		glm::dvec3 target = GetPosition(positions, positionStride, to);
+
+		//The collapse must not flip or squash any triangle that stays
+		bool valid = true;
+		bool connected = false;
+		const std::vector<unsigned int>& fromTriangles = vertexTriangles[from];
+		for (size_t i = 0; i < fromTriangles.size() && valid; i++)
+		{
+			unsigned int t = fromTriangles[i];
+			if (!triangleAlive[t])
+				continue;
+
+			unsigned int* triangle = &triangles[t * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				connected = true;
+				continue;
+			}
+
+			glm::dvec3 corners[3], moved[3];
+			for (int k = 0; k < 3; k++)
+			{
+				corners[k] = GetPosition(positions, positionStride, triangle[k]);
+				moved[k] = triangle[k] == from ? target : corners[k];
+			}
+
+			glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			if (glm::dot(before, after) <= 0.0 || glm::length(after) < glm::length(before) * 1e-3)
+				valid = false;
+		}
+
+		if (!valid || !connected)
+			continue;
+
+		//Triangles on the collapsed edge disappear, the others now use to instead of from
+		for (size_t i = 0; i < fromTriangles.size(); i++)
+		{
+			unsigned int t = fromTriangles[i];
+			if (!triangleAlive[t])
+				continue;
+
+			unsigned int* triangle = &triangles[t * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			{
+				triangleAlive[t] = false;
+				indexCount -= 3;
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				if (triangle[k] == from)
+					triangle[k] = to;
+			}
+			vertexTriangles[to].push_back(t);
+		}
+
+		vertexAlive[from] = false;
+		AddQuadric(quadrics[to], quadrics[from]);
+		versions[to]++;
+		if (collapse.error > maxError)
+			maxError = collapse.error;
+
+		//Measuring again every edge around to, its quadric changed
+		std::vector<unsigned int>& toTriangles = vertexTriangles[to];
+		size_t kept = 0;
+		for (size_t i = 0; i < toTriangles.size(); i++)
+		{
+			unsigned int t = toTriangles[i];
+			if (!triangleAlive[t])
+				continue;
+			toTriangles[kept++] = t;
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int other = triangles[t * 3 + k];
+				if (other == to)
+					continue;
+				pushCollapse(other, to);
+				pushCollapse(to, other);
+			}
+		}
+		toTriangles.resize(kept);
+	}
+
+	size_t written = 0;
+	for (size_t t = 0; t < numOfTriangles; t++)
+	{
+		if (!triangleAlive[t])
+			continue;
+
+		memcpy(destination + written, &triangles[t * 3], sizeof(unsigned int) * 3);
+		written += 3;
+	}
+
+	if (resultError != nullptr)
+		*resultError = maxError;
+
+	return written;
+}
+
+void MeshSimplifier::BuildLODChain(const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices,
+	std::vector<unsigned int>& chainIndices, std::vector<LODLevel>& levels, size_t maxLevels)
+{
+	chainIndices.assign(indices, indices + numOfIndices);
+	levels.clear();
+
+	LODLevel full = { 0, (unsigned int)numOfIndices, 0.0f };
+	levels.push_back(full);
+
+	std::vector<unsigned int> simplified(numOfIndices);
+	std::vector<unsigned int> sorted(numOfIndices);
+
+	while (levels.size() < maxLevels && levels.back().indexCount / 3 >= MIN_LOD_TRIANGLES * 2)
+	{
+		const LODLevel previous = levels.back();
+		size_t target = (previous.indexCount / 6) * 3;
+
+		//Each level starts from the previous one, so the errors add up
+		float error = 0.0f;
+		size_t count = Simplify(simplified.data(), &chainIndices[previous.firstIndex], previous.indexCount, positions, positionStride,
+			numOfVertices, target, 1e30f, &error);
+
+		//Locked borders and seams can stop the simplification, a level that barely shrinks is not worth its memory
+		if (count == 0 || count > previous.indexCount * 3 / 4)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(sorted.data(), simplified.data(), count, numOfVertices);
+
+		LODLevel level = { (unsigned int)chainIndices.size(), (unsigned int)count, previous.error + error };
+		chainIndices.insert(chainIndices.end(), sorted.begin(), sorted.begin() + count);
+		levels.push_back(level);
+	}
+}
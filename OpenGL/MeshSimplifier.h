@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+/*
+One level of detail of a mesh, a range of its index buffer.
+*/
+struct LODLevel
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	float error;		//how far the surface moved from the full detail mesh, in object space units
+};
+
+/*
+Mesh simplification with quadric error metrics (Garland and Heckbert).
+
+Edges are collapsed one at a time, always the one that moves the surface the least, until the target triangle count
+is reached. A vertex always collapses onto one of its neighbours, so the simplified mesh reuses the vertex buffer of
+the original and only needs a new index buffer. Vertices on open borders and on attribute seams (copies sharing
+a position) are never moved, so holes do not grow and textures do not tear.
+*/
+namespace MeshSimplifier
+{
+	const size_t MAX_LOD_LEVELS = 8;
+	//A level with fewer triangles than this is the last one
+	const size_t MIN_LOD_TRIANGLES = 32;
+
+	/**
+	* Simplifies a mesh down to a number of indices.
+	*
+	* @param destination Receives the new indices, must hold numOfIndices of them
+	* @param positions Position of the first vertex, 3 floats
+	* @param positionStride Bytes from one position to the next
+	* @param targetIndexCount How many indices to aim for, fewer may be impossible without breaking the surface
+	* @param targetError Stops earlier when the next collapse would move the surface further than this distance
+	* @param resultError Receives how far the surface moved, in the same units as the positions
+	* @return The number of indices written to destination
+	*/
+	size_t Simplify(unsigned int* destination, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+		size_t numOfVertices, size_t targetIndexCount, float targetError, float* resultError);
+
+	/**
+	* Builds a chain of levels of detail, each one with about half the triangles of the previous one.
+	* Stops when a level can not be reduced much further or has few triangles left.
+	* Every level is sorted for the vertex cache.
+	*
+	* @param chainIndices Receives the indices of every level one after the other, starting with the full mesh
+	* @param levels Receives the range of each level inside chainIndices, levels[0] is the full mesh
+	* @param maxLevels Most levels to build, the full mesh included
+	*/
+	void BuildLODChain(const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices,
+		std::vector<unsigned int>& chainIndices, std::vector<LODLevel>& levels, size_t maxLevels = MAX_LOD_LEVELS);
+}
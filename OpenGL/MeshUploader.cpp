@@ -0,0 +1,281 @@
+#include "MeshUploader.h"
+
+#include <string.h>
+#include <exception>
+
+MeshUploader::MeshUploader()
+{
+	bytesPerFrame = 0;
+	stagingBuffer = 0;
+	stopping = false;
+	preparing = 0;
+}
+
+void MeshUploader::CreateUploader(unsigned int workerCount, GLsizeiptr bytesPerFrame)
+{
+	ClearUploader();
+
+	this->bytesPerFrame = bytesPerFrame;
+	glGenBuffers(1, &stagingBuffer);
+
+	stopping = false;
+	if (workerCount == 0)
+		workerCount = 1;
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&MeshUploader::WorkerLoop, this));
+}
+
+std::future<Mesh*> MeshUploader::Enqueue(Mesh* mesh, LoadFunction load, unsigned int flags, ReadyFunction onReady)
+{
+	return QueueJob(mesh, nullptr, MeshPool::INVALID_HANDLE, load, flags, onReady);
+}
+
+std::future<Mesh*> MeshUploader::Enqueue(MeshPool& pool, MeshPool::Handle handle, LoadFunction load, unsigned int flags, ReadyFunction onReady)
+{
+	return QueueJob(nullptr, &pool, handle, load, flags, onReady);
+}
+
+std::future<Mesh*> MeshUploader::QueueJob(Mesh* mesh, MeshPool* pool, MeshPool::Handle handle, LoadFunction load, unsigned int flags, ReadyFunction onReady)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->mesh = mesh;
+	job->pool = pool;
+	job->handle = handle;
+	job->load = load;
+	job->flags = flags & ~Mesh::SHARE_GEOMETRY;
+	job->onReady = onReady;
+	job->allocated = false;
+	job->segment = 0;
+	job->segmentOffset = 0;
+
+	std::future<Mesh*> future = job->promise.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(job);
+	}
+	wake.notify_one();
+
+	return future;
+}
+
+void MeshUploader::WorkerLoop()
+{
+	for (;;)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queued.empty(); });
+			if (stopping)
+				return;
+
+			job = queued.front();
+			queued.pop_front();
+			preparing++;
+		}
+
+		bool valid = false;
+		std::exception_ptr error;
+		try
+		{
+			job->load(job->data);
+			valid = Mesh::PrepareMeshData(job->data, job->flags);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		//Data that could not be loaded or prepared is dropped, the mesh stays empty.
+		//What the load function threw is thrown again by the future instead of ending the worker thread
+		if (error)
+		{
+			job->data.Clear();
+			job->promise.set_exception(error);
+		}
+		else if (!valid)
+		{
+			job->promise.set_value(nullptr);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (valid)
+			prepared.push_back(job);
+		preparing--;
+	}
+}
+
+GLsizeiptr MeshUploader::Update()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!prepared.empty())
+		{
+			uploading.push_back(prepared.front());
+			prepared.pop_front();
+		}
+	}
+
+	if (uploading.empty() || stagingBuffer == 0 || bytesPerFrame <= 0)
+		return 0;
+
+	//Orphaning: the driver gives fresh memory, last frame copies may still be reading the old one.
+	//Nothing else can use the new memory yet, so it is mapped without waiting for the GPU
+	glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+	glBufferData(GL_COPY_READ_BUFFER, bytesPerFrame, NULL, GL_STREAM_DRAW);
+	unsigned char* staging = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytesPerFrame,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (staging == nullptr)
+	{
+		printf("Staging buffer could not be mapped!\n");
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return 0;
+	}
+
+	copies.clear();
+	finished.clear();
+
+	GLsizeiptr used = 0;
+	while (used < bytesPerFrame && !uploading.empty())
+	{
+		Job& job = *uploading.front();
+
+		//The pool may have moved the mesh since the last Update, or released it
+		Mesh* mesh = GetMesh(job);
+		if (mesh == nullptr)
+		{
+			CancelJob(job);
+			uploading.pop_front();
+			continue;
+		}
+
+		if (!job.allocated)
+			AllocateMesh(job, mesh);
+
+		size_t streamCount = job.data.streams.size();
+		const std::vector<unsigned char>& source = job.segment < streamCount ? job.data.streams[job.segment] : job.data.indices;
+
+		GLsizeiptr size = (GLsizeiptr)(source.size() - job.segmentOffset);
+		if (size > bytesPerFrame - used)
+			size = bytesPerFrame - used;
+
+		if (size > 0)
+		{
+			Copy copy;
+			copy.buffer = job.segment < streamCount ? mesh->GetVertexBuffer() : mesh->GetIndexBuffer();
+			copy.readOffset = used;
+			copy.writeOffset = (job.segment < streamCount ? mesh->GetStreamOffset((GLuint)job.segment) : 0) + (GLintptr)job.segmentOffset;
+			copy.size = size;
+			copies.push_back(copy);
+
+			memcpy(staging + used, source.data() + job.segmentOffset, size);
+			used += size;
+			job.segmentOffset += size;
+		}
+
+		if (job.segmentOffset == source.size())
+		{
+			job.segment++;
+			job.segmentOffset = 0;
+		}
+
+		if (job.segment > streamCount)
+		{
+			finished.push_back(uploading.front());
+			uploading.pop_front();
+		}
+	}
+
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+	for (size_t i = 0; i < copies.size(); i++)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, copies[i].buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, copies[i].readOffset, copies[i].writeOffset, copies[i].size);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	//The copies are queued before any draw using the meshes, so they can be drawn right away
+	for (size_t i = 0; i < finished.size(); i++)
+	{
+		Job& job = *finished[i];
+
+		//An earlier ready callback may have released it
+		Mesh* mesh = GetMesh(job);
+		if (mesh == nullptr)
+		{
+			CancelJob(job);
+			continue;
+		}
+
+		mesh->FinishUpload(job.data);
+		job.data.Clear();
+
+		if (job.onReady)
+			job.onReady(mesh);
+		job.promise.set_value(mesh);
+	}
+	finished.clear();
+
+	return used;
+}
+
+void MeshUploader::AllocateMesh(Job& job, Mesh* mesh)
+{
+	mesh->CreateEmptyMesh(job.data.layout, job.data.numOfVertices, job.data.indexType, job.data.GetTotalIndexCount(), job.flags);
+	job.allocated = true;
+}
+
+void MeshUploader::CancelJob(Job& job)
+{
+	//A released pool mesh is already cleared
+	Mesh* mesh = GetMesh(job);
+	if (job.allocated && mesh != nullptr)
+		mesh->ClearMesh();
+	job.data.Clear();
+	job.promise.set_value(nullptr);
+}
+
+size_t MeshUploader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return queued.size() + preparing + prepared.size() + uploading.size();
+}
+
+void MeshUploader::ClearUploader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	//A worker finishes the mesh it is preparing before it stops
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	for (size_t i = 0; i < queued.size(); i++)
+		CancelJob(*queued[i]);
+	for (size_t i = 0; i < prepared.size(); i++)
+		CancelJob(*prepared[i]);
+	for (size_t i = 0; i < uploading.size(); i++)
+		CancelJob(*uploading[i]);
+	queued.clear();
+	prepared.clear();
+	uploading.clear();
+
+	if (stagingBuffer != 0)
+	{
+		glDeleteBuffers(1, &stagingBuffer);
+		stagingBuffer = 0;
+	}
+}
+
+MeshUploader::~MeshUploader()
+{
+	ClearUploader();
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Mesh.h"
+#include "MeshData.h"
+#include "MeshPool.h"
+
+/*
+Loads meshes in the background without stalling the frame.
+
+Worker threads fill and prepare the MeshData of each mesh (reading files, OPTIMIZE, BUILD_MESHLETS, BUILD_LODS...),
+none of which needs OpenGL. Once a mesh is prepared, Update (called once per frame on the thread owning the context)
+writes its bytes into a staging buffer and copies them into the mesh buffers with glCopyBufferSubData,
+never more than bytesPerFrame in one frame. A big mesh takes a few frames instead of one long hitch.
+
+A mesh draws nothing until all of its data has been copied, then the ready callback runs and its future is set.
+*/
+class MeshUploader
+{
+public:
+	//Fills the data of a mesh, runs on a worker thread so it must not call OpenGL. What it throws goes to the future
+	typedef std::function<void(MeshData&)> LoadFunction;
+	//Runs on the thread calling Update once the mesh can be drawn
+	typedef std::function<void(Mesh*)> ReadyFunction;
+
+	MeshUploader();
+
+	/**
+	* Starts the worker threads and creates the staging buffer.
+	*
+	* @param workerCount How many meshes can be prepared at the same time
+	* @param bytesPerFrame Most bytes copied to the GPU by one Update
+	*/
+	void CreateUploader(unsigned int workerCount, GLsizeiptr bytesPerFrame);
+
+	/**
+	* Queues a mesh to be loaded. Can be called from any thread.
+	*
+	* @param mesh The mesh receiving the data, it must stay alive until it is ready
+	* @param load Fills the mesh data, the layout and streams and indices at least
+	* @param flags The CreateMesh flags, SHARE_GEOMETRY is not supported and ignored
+	* @param onReady Called once the mesh can be drawn, may be empty
+	* @return Gives the mesh once it can be drawn, or nullptr when the uploader was cleared first or the data is invalid.
+	* Throws what load threw
+	*/
+	std::future<Mesh*> Enqueue(Mesh* mesh, LoadFunction load, unsigned int flags = 0, ReadyFunction onReady = ReadyFunction());
+
+	/**
+	* Queues a mesh of a pool to be loaded. Can be called from any thread, but the pool is only read by Update.
+	* The handle is resolved every Update, so the pool may move its meshes meanwhile. Releasing the handle
+	* cancels the load and sets the future to nullptr. The pool has to outlive the uploader or its ClearUploader.
+	*
+	* @return Gives the mesh once it can be drawn, a pointer only valid until the pool changes (see MeshPool)
+	*/
+	std::future<Mesh*> Enqueue(MeshPool& pool, MeshPool::Handle handle, LoadFunction load, unsigned int flags = 0, ReadyFunction onReady = ReadyFunction());
+
+	/**
+	* Copies the next bytes of the prepared meshes to the GPU and finishes the meshes that are complete.
+	* Has to be called once per frame by the thread owning the OpenGL context.
+	*
+	* @return The number of bytes copied
+	*/
+	GLsizeiptr Update();
+
+	/*Takes effect on the next Update*/
+	void SetBytesPerFrame(GLsizeiptr bytes) { bytesPerFrame = bytes; }
+	GLsizeiptr GetBytesPerFrame() { return bytesPerFrame; }
+
+	/*Meshes queued and not ready yet*/
+	size_t GetPendingCount();
+
+	/**
+	Stops the worker threads, drops the meshes not ready yet and deletes the staging buffer.
+	It does NOT destroy the class MeshUploader.
+	*/
+	void ClearUploader();
+
+	~MeshUploader();
+
+private:
+	struct Job
+	{
+		Mesh* mesh;					//nullptr for a mesh of a pool
+		MeshPool* pool;
+		MeshPool::Handle handle;
+		LoadFunction load;
+		unsigned int flags;
+		ReadyFunction onReady;
+		std::promise<Mesh*> promise;
+
+		MeshData data;
+		bool allocated;
+		size_t segment;				//stream being copied, the indices come after the last stream
+		size_t segmentOffset;		//bytes of it already copied
+	};
+
+	//One glCopyBufferSubData out of the staging buffer
+	struct Copy
+	{
+		GLuint buffer;
+		GLintptr readOffset;
+		GLintptr writeOffset;
+		GLsizeiptr size;
+	};
+
+	GLsizeiptr bytesPerFrame;
+	GLuint stagingBuffer;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	std::deque<std::shared_ptr<Job> > queued;		//waiting for a worker, guarded by mutex
+	std::deque<std::shared_ptr<Job> > prepared;		//waiting for Update, guarded by mutex
+	size_t preparing;								//jobs held by a worker, guarded by mutex
+	std::deque<std::shared_ptr<Job> > uploading;	//only touched by Update
+
+	std::vector<Copy> copies;						//reused every Update
+	std::vector<std::shared_ptr<Job> > finished;
+
+	std::future<Mesh*> QueueJob(Mesh* mesh, MeshPool* pool, MeshPool::Handle handle, LoadFunction load, unsigned int flags, ReadyFunction onReady);
+	Mesh* GetMesh(Job& job) { return job.pool != nullptr ? job.pool->Get(job.handle) : job.mesh; }
+
+	void WorkerLoop();
+	void AllocateMesh(Job& job, Mesh* mesh);
+	void CancelJob(Job& job);
+};
@@ -0,0 +1,139 @@
+#include "MeshletBuilder.h"
+
+#include <math.h>
+
+namespace
+{
+	glm::vec3 GetPosition(const float* positions, size_t positionStride, unsigned int vertex)
+	{
+		const float* position = (const float*)((const char*)positions + positionStride * vertex);
+		return glm::vec3(position[0], position[1], position[2]);
+	}
+
+	Meshlet FinishMeshlet(const unsigned int* indices, size_t firstIndex, size_t endIndex, const std::vector<unsigned int>& vertices,
+		const float* positions, size_t positionStride)
+	{
+		Meshlet meshlet;
+		meshlet.firstIndex = (unsigned int)firstIndex;
+		meshlet.indexCount = (unsigned int)(endIndex - firstIndex);
+
+		//Sphere around the box of the vertices, not the smallest sphere but close and quick to find
+		glm::vec3 min = GetPosition(positions, positionStride, vertices[0]);
+		glm::vec3 max = min;
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			glm::vec3 position = GetPosition(positions, positionStride, vertices[i]);
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+
+		meshlet.centre = (min + max) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			float distance = glm::length(GetPosition(positions, positionStride, vertices[i]) - meshlet.centre);
+			if (distance > meshlet.radius)
+				meshlet.radius = distance;
+		}
+
+		//Cone around the triangle normals: the average normal, opened wide enough to hold all of them
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis(0.0f);
+		for (size_t i = firstIndex; i < endIndex; i += 3)
+		{
+			glm::vec3 a = GetPosition(positions, positionStride, indices[i]);
+			glm::vec3 b = GetPosition(positions, positionStride, indices[i + 1]);
+			glm::vec3 c = GetPosition(positions, positionStride, indices[i + 2]);
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+
+			normals.push_back(normal / length);
+			axis += normal / length;
+		}
+
+		float axisLength = glm::length(axis);
+		float minDot = 1.0f;
+		if (axisLength > 0.0f)
+		{
+			axis /= axisLength;
+			for (size_t i = 0; i < normals.size(); i++)
+				minDot = fminf(minDot, glm::dot(axis, normals[i]));
+		}
+
+		if (axisLength == 0.0f || minDot <= 0.1f)
+		{
+			//Normals spread over (almost) a hemisphere, some triangle always faces the camera
+			meshlet.coneAxis = glm::vec3(0.0f);
+			meshlet.coneCutoff = 1.0f;
+		}
+		else
+		{
+			//Sine of the cone angle, the view direction has to be that far past perpendicular to hide every triangle
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+
+		return meshlet;
+	}
+}
+
+std::vector<Meshlet> MeshletBuilder::Build(const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices,
+	size_t maxVertices, size_t maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	if (numOfIndices < 3)
+		return meshlets;
+
+	//The meshlet each vertex was last added to, to count the vertices of the current one without searching it
+	std::vector<unsigned int> vertexMeshlet(numOfVertices, ~0u);
+	std::vector<unsigned int> vertices;
+	vertices.reserve(maxVertices);
+
+	unsigned int current = 0;
+	size_t firstIndex = 0;
+	size_t triangles = 0;
+
+	for (size_t i = 0; i + 2 < numOfIndices; i += 3)
+	{
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+		size_t newVertices = (vertexMeshlet[a] != current) + (vertexMeshlet[b] != current && b != a) + (vertexMeshlet[c] != current && c != a && c != b);
+
+		//The triangle does not fit anymore, the current meshlet is done
+		if (vertices.size() + newVertices > maxVertices || triangles + 1 > maxTriangles)
+		{
+			meshlets.push_back(FinishMeshlet(indices, firstIndex, i, vertices, positions, positionStride));
+
+			current++;
+			firstIndex = i;
+			triangles = 0;
+			vertices.clear();
+		}
+
+		unsigned int triangle[3] = { a, b, c };
+		for (int k = 0; k < 3; k++)
+		{
+			if (vertexMeshlet[triangle[k]] != current)
+			{
+				vertexMeshlet[triangle[k]] = current;
+				vertices.push_back(triangle[k]);
+			}
+		}
+
+		triangles++;
+	}
+
+	meshlets.push_back(FinishMeshlet(indices, firstIndex, numOfIndices - numOfIndices % 3, vertices, positions, positionStride));
+	return meshlets;
+}
+
+bool MeshletBuilder::IsBackFacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+{
+	//A triangle faces away when the direction from the camera to it is along its normal,
+	//for the whole meshlet that direction has to be within the cone for every point of the sphere
+	glm::vec3 view = meshlet.centre - cameraPosition;
+	return glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+}
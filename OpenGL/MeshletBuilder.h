@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+A small cluster of triangles of a mesh, drawn or skipped as a whole.
+Its triangles are a contiguous range of the mesh index buffer.
+*/
+struct Meshlet
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+
+	//Sphere around every vertex of the meshlet
+	glm::vec3 centre;
+	float radius;
+
+	//Every triangle normal is within the cone around coneAxis (see MeshletBuilder::IsBackFacing)
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+/*
+Splits meshes into meshlets and tests their visibility.
+*/
+namespace MeshletBuilder
+{
+	//Limits of a meshlet, the usual sizes for mesh shading hardware
+	const size_t MAX_VERTICES = 64;
+	const size_t MAX_TRIANGLES = 124;
+
+	/**
+	* Cuts the triangle list into meshlets, in the order the triangles are already in.
+	* Triangles sorted for the vertex cache (MeshOptimizer) give compact meshlets.
+	*
+	* @param positions Position of the first vertex, 3 floats
+	* @param positionStride Bytes from one position to the next
+	*/
+	std::vector<Meshlet> Build(const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride, size_t numOfVertices,
+		size_t maxVertices = MAX_VERTICES, size_t maxTriangles = MAX_TRIANGLES);
+
+	/**
+	* @param cameraPosition The camera position in the same space as the meshlet (object space)
+	* @return true when every triangle of the meshlet faces away from the camera
+	*/
+	bool IsBackFacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+}
@@ -0,0 +1,206 @@
+#include "MorphTargets.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <glm/gtc/packing.hpp>
+
+MorphTargets::MorphTargets()
+{
+	vertexCount = 0;
+	targetCount = 0;
+	deltaBuffer = 0;
+	deltaTexture = 0;
+}
+
+bool MorphTargets::CreateMorphTargets(GLsizei numOfVertices, GLsizei numOfTargets, const glm::vec3* positionDeltas, const std::vector<unsigned int>* vertexRemap)
+{
+	ClearMorphTargets();
+
+	if (numOfVertices <= 0 || numOfTargets <= 0 || positionDeltas == nullptr)
+	{
+		printf("Morph targets without any delta!\n");
+		return false;
+	}
+
+	if (vertexRemap != nullptr && vertexRemap->size() != (size_t)numOfVertices)
+	{
+		printf("The vertex remap is for %u vertices, the morph targets move %d!\n", (unsigned int)vertexRemap->size(), numOfVertices);
+		return false;
+	}
+
+	//The optimizer numbers the vertices it keeps from 0, the drawn count is the largest new number + 1
+	GLsizei drawnVertices = numOfVertices;
+	if (vertexRemap != nullptr)
+	{
+		drawnVertices = 0;
+		for (size_t i = 0; i < vertexRemap->size(); i++)
+		{
+			if ((*vertexRemap)[i] != ~0u)
+				drawnVertices = glm::max(drawnVertices, (GLsizei)(*vertexRemap)[i] + 1);
+		}
+	}
+
+	//Texels past the limit of the driver read as 0, the targets would do nothing instead of failing
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if ((long long)drawnVertices * numOfTargets > maxTexels)
+	{
+		printf("%d targets of %d vertices need more than the %d texels of a texture buffer!\n", numOfTargets, drawnVertices, maxTexels);
+		return false;
+	}
+
+	vertexCount = drawnVertices;
+	targetCount = numOfTargets;
+	weights.assign(numOfTargets, 0.0f);
+	minDeltas.assign(numOfTargets, glm::vec3(0.0f));
+	maxDeltas.assign(numOfTargets, glm::vec3(0.0f));
+
+	//Half floats keep small moves precise (the precision is relative) at 8 bytes a texel
+	//Vertices the optimizer dropped are never drawn, their moves are left out
+	size_t deltaCount = (size_t)numOfVertices * numOfTargets;
+	std::vector<glm::uint64> texels((size_t)drawnVertices * numOfTargets);
+	for (size_t i = 0; i < deltaCount; i++)
+	{
+		size_t target = i / numOfVertices;
+		size_t vertex = i % numOfVertices;
+		if (vertexRemap != nullptr)
+		{
+			vertex = (*vertexRemap)[vertex];
+			if (vertex == ~0u)
+				continue;
+		}
+
+		minDeltas[target] = glm::min(minDeltas[target], positionDeltas[i]);
+		maxDeltas[target] = glm::max(maxDeltas[target], positionDeltas[i]);
+		texels[target * drawnVertices + vertex] = glm::packHalf4x16(glm::vec4(positionDeltas[i], 0.0f));
+	}
+
+	glGenBuffers(1, &deltaBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, deltaBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::uint64) * texels.size(), texels.data(), GL_STATIC_DRAW);
+
+	glGenTextures(1, &deltaTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, deltaTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16F, deltaBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	return true;
+}
+
+void MorphTargets::SetWeights(const float* weights)
+{
+	this->weights.assign(weights, weights + targetCount);
+}
+
+MorphTargets::Uniforms MorphTargets::FindUniforms(Shader& shader)
+{
+	Uniforms uniforms;
+	uniforms.deltas = shader.GetUniformLocation("morphDeltas");
+	uniforms.offsets = shader.GetUniformLocation("morphOffsets");
+	uniforms.weights = shader.GetUniformLocation("morphWeights");
+	uniforms.count = shader.GetUniformLocation("morphCount");
+	uniforms.baseVertex = shader.GetUniformLocation("morphBaseVertex");
+	return uniforms;
+}
+
+GLsizei MorphTargets::Bind(const Uniforms& uniforms, GLint baseVertex)
+{
+	//Only the targets with a weight, the largest first when there are too many
+	GLint active[MAX_ACTIVE_TARGETS];
+	GLsizei activeCount = 0;
+	for (GLsizei i = 0; i < targetCount; i++)
+	{
+		if (weights[i] == 0.0f)
+			continue;
+
+		if (activeCount < MAX_ACTIVE_TARGETS)
+		{
+			active[activeCount++] = i;
+			continue;
+		}
+
+		GLsizei smallest = 0;
+		for (GLsizei j = 1; j < MAX_ACTIVE_TARGETS; j++)
+		{
+			if (fabsf(weights[active[j]]) < fabsf(weights[active[smallest]]))
+				smallest = j;
+		}
+		if (fabsf(weights[i]) > fabsf(weights[active[smallest]]))
+			active[smallest] = i;
+	}
+
+	//The shader reads texel offsets, so it never needs the vertex count
+	GLint offsets[MAX_ACTIVE_TARGETS];
+	GLfloat activeWeights[MAX_ACTIVE_TARGETS];
+	for (GLsizei i = 0; i < activeCount; i++)
+	{
+		offsets[i] = active[i] * vertexCount;
+		activeWeights[i] = weights[active[i]];
+	}
+
+	glActiveTexture(GL_TEXTURE0 + DELTA_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, deltaTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(uniforms.deltas, DELTA_TEXTURE_UNIT);
+	glUniform1i(uniforms.count, activeCount);
+	glUniform1i(uniforms.baseVertex, baseVertex);
+	if (activeCount > 0)
+	{
+		glUniform1iv(uniforms.offsets, activeCount, offsets);
+		glUniform1fv(uniforms.weights, activeCount, activeWeights);
+	}
+
+	return activeCount;
+}
+
+void MorphTargets::Unbind()
+{
+	glActiveTexture(GL_TEXTURE0 + DELTA_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+Bounds MorphTargets::GetMorphedBounds(const Bounds& baseBounds)
+{
+	if (baseBounds.IsEmpty())
+		return baseBounds;
+
+	//Each target can move a vertex by at most its largest move, all of them together by the sum
+	glm::vec3 min = baseBounds.min, max = baseBounds.max;
+	for (GLsizei i = 0; i < targetCount; i++)
+	{
+		min += minDeltas[i];
+		max += maxDeltas[i];
+	}
+
+	return Bounds::FromBox(min, max);
+}
+
+void MorphTargets::ClearMorphTargets()
+{
+	if (deltaTexture != 0)
+	{
+		glDeleteTextures(1, &deltaTexture);
+		deltaTexture = 0;
+	}
+
+	if (deltaBuffer != 0)
+	{
+		glDeleteBuffers(1, &deltaBuffer);
+		deltaBuffer = 0;
+	}
+
+	weights.clear();
+	minDeltas.clear();
+	maxDeltas.clear();
+	vertexCount = 0;
+	targetCount = 0;
+}
+
+MorphTargets::~MorphTargets()
+{
+	ClearMorphTargets();
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Shader.h"
+
+/*
+Blend shapes of a mesh (facial expressions, corrective shapes) blended on the GPU.
+
+Every target stores how far each vertex moves from the base mesh. The moves of all the targets live in one
+texture buffer as half floats, uploaded once, and the vertex shader (see Shaders/shader_morph.vert) adds the
+moves of the few targets whose weight is not 0 to the position it reads from the mesh. Changing an expression
+only changes a handful of uniforms, the vertices of the mesh are never uploaded again.
+
+Many meshes can share the same targets, each draw with its own weights.
+
+The shader finds the moves of a vertex by gl_VertexID, so they must follow the vertices in the order the mesh
+draws them. Mesh::OPTIMIZE reorders (and may drop) vertices: pass the MeshData::vertexRemap of the prepared
+mesh and the moves can stay in the order the mesh was built from. gl_VertexID of a mesh stored in a
+GeometryArena starts at its base vertex, which Bind has to be given.
+*/
+class MorphTargets
+{
+public:
+	//Where the shader reads the targets from, see FindUniforms
+	struct Uniforms
+	{
+		GLint deltas;		//samplerBuffer morphDeltas
+		GLint offsets;		//int morphOffsets[MAX_ACTIVE_TARGETS]
+		GLint weights;		//float morphWeights[MAX_ACTIVE_TARGETS]
+		GLint count;		//int morphCount
+		GLint baseVertex;	//int morphBaseVertex
+	};
+
+	MorphTargets();
+
+	/**
+	* Uploads the targets, one after the other.
+	*
+	* @param numOfVertices Vertices of the mesh, every target moves all of them
+	* @param numOfTargets Targets in the deltas
+	* @param positionDeltas numOfVertices moves of the first target, then of the second...
+	* @param vertexRemap MeshData::vertexRemap of a mesh prepared with OPTIMIZE, with the moves in the order the mesh
+	* was built from. nullptr when the moves are already in the order the mesh is drawn with
+	* @return false when there is nothing to upload, the remap is not for numOfVertices vertices or the moves need more
+	* texels than GL_MAX_TEXTURE_BUFFER_SIZE
+	*/
+	bool CreateMorphTargets(GLsizei numOfVertices, GLsizei numOfTargets, const glm::vec3* positionDeltas, const std::vector<unsigned int>* vertexRemap = nullptr);
+
+	void SetWeight(GLsizei target, float weight) { weights[target] = weight; }
+
+	/**
+	* @param weights One weight per target
+	*/
+	void SetWeights(const float* weights);
+
+	float GetWeight(GLsizei target) { return weights[target]; }
+
+	/**
+	* Finds the morph uniforms of a shader, once after it is created.
+	*/
+	static Uniforms FindUniforms(Shader& shader);
+
+	/**
+	* Binds the targets and sets the uniforms of the shader in use for the next draws.
+	* When more than MAX_ACTIVE_TARGETS targets have a weight, the ones with the largest weights are kept.
+	*
+	* @param baseVertex First vertex of the mesh in its vertex buffer: 0 for a mesh with its own buffers,
+	* arena->GetRange(mesh.GetArenaAllocation()).baseVertex for a mesh stored in a GeometryArena
+	* @return The targets blended, 0 when every weight is 0
+	*/
+	GLsizei Bind(const Uniforms& uniforms, GLint baseVertex = 0);
+
+	void Unbind();
+
+	/**
+	* The bounds of the base mesh grown to hold every target at once, for weights from 0 to 1 (see Mesh::SetBounds).
+	*/
+	Bounds GetMorphedBounds(const Bounds& baseBounds);
+
+	GLsizei GetTargetCount() { return targetCount; }
+
+	/**
+	Clear all buffers from the GPU and sets them back to 0.
+	It does NOT destroy the class MorphTargets.
+	*/
+	void ClearMorphTargets();
+
+	~MorphTargets();
+
+	//Targets blended by one draw, the size of the uniform arrays in the shader
+	static const GLsizei MAX_ACTIVE_TARGETS = 8;
+
+	//Texture unit the deltas are bound to, after BonePalette::BONE_TEXTURE_UNIT
+	static const GLint DELTA_TEXTURE_UNIT = 2;
+
+private:
+	GLsizei vertexCount;		//as drawn, after the remap
+	GLsizei targetCount;
+
+	std::vector<float> weights;
+	std::vector<glm::vec3> minDeltas, maxDeltas;	//smallest and largest move of each target
+
+	GLuint deltaBuffer;		//the moves of every target, RGBA16F texels
+	GLuint deltaTexture;	//texture buffer view of deltaBuffer
+};
@@ -0,0 +1,473 @@
+#include "ObjLoader.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+
+namespace
+{
+	//Chunks smaller than this are not worth a thread
+	const size_t MIN_CHUNK_SIZE = 1 << 16;
+
+	const int MISSING = INT_MIN;
+
+	//One corner of a face: position, texture coordinate and normal index, 0 based.
+	//Negative indices in the file count back from the last element read, they are stored relative to
+	//the start of the chunk (bit k of relative set) until the sizes of the chunks before are known.
+	struct Corner
+	{
+		int index[3];
+		unsigned char relative;
+	};
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+		std::vector<Corner> corners;	//3 per triangle
+	};
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline const char* SkipSpaces(const char* c, const char* end)
+	{
+		while (c < end && (*c == ' ' || *c == '\t'))
+			c++;
+		return c;
+	}
+
+	inline const char* SkipLine(const char* c, const char* end)
+	{
+		while (c < end && *c != '\n')
+			c++;
+		return c < end ? c + 1 : end;
+	}
+
+	int ParseInt(const char*& c, const char* end)
+	{
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+'))
+		{
+			negative = *c == '-';
+			c++;
+		}
+
+		int value = 0;
+		while (c < end && IsDigit(*c))
+			value = value * 10 + (*c++ - '0');
+
+		return negative ? -value : value;
+	}
+
+	double PowerOfTen(int exponent)
+	{
+		//Every power up to 1e22 is exact in a double
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		return exponent <= 22 ? powers[exponent] : pow(10.0, exponent);
+	}
+
+	void ParseFace(const char* c, const char* end, Chunk& chunk, std::vector<Corner>& polygon)
+	{
+		int counts[3] = { (int)(chunk.positions.size() / 3), (int)(chunk.uvs.size() / 2), (int)(chunk.normals.size() / 3) };
+
+		polygon.clear();
+		for (;;)
+		{
+			c = SkipSpaces(c, end);
+			if (c >= end || !(IsDigit(*c) || *c == '-' || *c == '+'))
+				break;
+
+			//v, v/t, v//n or v/t/n
+			int values[3] = { ParseInt(c, end), 0, 0 };
+			for (int k = 1; k < 3 && c < end && *c == '/'; k++)
+			{
+				c++;
+				if (c < end && (IsDigit(*c) || *c == '-'))
+					values[k] = ParseInt(c, end);
+			}
+
+			//Skips anything else glued to the corner
+			while (c < end && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n')
+				c++;
+
+			Corner corner;
+			corner.relative = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				if (values[k] > 0)
+				{
+					corner.index[k] = values[k] - 1;
+				}
+				else if (values[k] < 0)
+				{
+					corner.index[k] = counts[k] + values[k];
+					corner.relative |= 1 << k;
+				}
+				else
+				{
+					corner.index[k] = MISSING;
+				}
+			}
+			polygon.push_back(corner);
+		}
+
+		//Fan from the first corner, fine for the convex polygons OBJ exporters write
+		for (size_t i = 1; i + 1 < polygon.size(); i++)
+		{
+			chunk.corners.push_back(polygon[0]);
+			chunk.corners.push_back(polygon[i]);
+			chunk.corners.push_back(polygon[i + 1]);
+		}
+	}
+
+	void ParseChunk(Chunk& chunk)
+	{
+		std::vector<Corner> polygon;
+
+		const char* end = chunk.end;
+		const char* c = chunk.begin;
+		while (c < end)
+		{
+			c = SkipSpaces(c, end);
+			const char* line = c;
+			c = SkipLine(c, end);
+
+			if (end - line < 2)
+				continue;
+
+			if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+			{
+				const char* value = line + 2;
+				for (int k = 0; k < 3; k++)
+					chunk.positions.push_back(ObjLoader::ParseFloat(value, c));
+			}
+			else if (line[0] == 'v' && line[1] == 't')
+			{
+				const char* value = line + 2;
+				for (int k = 0; k < 2; k++)
+					chunk.uvs.push_back(ObjLoader::ParseFloat(value, c));
+			}
+			else if (line[0] == 'v' && line[1] == 'n')
+			{
+				const char* value = line + 2;
+				for (int k = 0; k < 3; k++)
+					chunk.normals.push_back(ObjLoader::ParseFloat(value, c));
+			}
+			else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+			{
+				ParseFace(line + 2, c, chunk, polygon);
+			}
+		}
+	}
+
+	inline unsigned int HashCorner(const int* index)
+	{
+		unsigned int h = (unsigned int)index[0] * 0x9E3779B1u + (unsigned int)index[1] * 0x85EBCA77u + (unsigned int)index[2] * 0xC2B2AE3Du;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	/*
+	Open addressing table from a corner (position, uv, normal) to the vertex made for it.
+	*/
+	class WeldTable
+	{
+	public:
+		WeldTable(size_t expectedVertices)
+		{
+			size_t capacity = 1024;
+			while (capacity < expectedVertices * 2)
+				capacity *= 2;
+			slots.assign(capacity, ~0u);
+		}
+
+		unsigned int Insert(const int* index)
+		{
+			if ((keys.size() + 1) * 2 > slots.size())
+				Grow();
+
+			size_t mask = slots.size() - 1;
+			size_t slot = HashCorner(index) & mask;
+			while (slots[slot] != ~0u)
+			{
+				const int* key = keys[slots[slot]].index;
+				if (key[0] == index[0] && key[1] == index[1] && key[2] == index[2])
+					return slots[slot];
+				slot = (slot + 1) & mask;
+			}
+
+			Corner key;
+			key.index[0] = index[0];
+			key.index[1] = index[1];
+			key.index[2] = index[2];
+			key.relative = 0;
+
+			slots[slot] = (unsigned int)keys.size();
+			keys.push_back(key);
+			return slots[slot];
+		}
+
+		//The corner each vertex was made for, in the order the vertices were made
+		const std::vector<Corner>& GetVertices() { return keys; }
+
+	private:
+		std::vector<unsigned int> slots;
+		std::vector<Corner> keys;
+
+		void Grow()
+		{
+			slots.assign(slots.size() * 2, ~0u);
+			size_t mask = slots.size() - 1;
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				size_t slot = HashCorner(keys[i].index) & mask;
+				while (slots[slot] != ~0u)
+					slot = (slot + 1) & mask;
+				slots[slot] = (unsigned int)i;
+			}
+		}
+	};
+
+	template<typename T>
+	void Concatenate(std::vector<T>& destination, const std::vector<Chunk>& chunks, std::vector<T> Chunk::* member)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+			total += (chunks[i].*member).size();
+
+		destination.reserve(total);
+		for (size_t i = 0; i < chunks.size(); i++)
+			destination.insert(destination.end(), (chunks[i].*member).begin(), (chunks[i].*member).end());
+	}
+}
+
+float ObjLoader::ParseFloat(const char*& c, const char* end)
+{
+	c = SkipSpaces(c, end);
+
+	bool negative = false;
+	if (c < end && (*c == '-' || *c == '+'))
+	{
+		negative = *c == '-';
+		c++;
+	}
+
+	//The digits are gathered in an integer, so the only rounding happens in the final scaling
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+
+	while (c < end && IsDigit(*c))
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+			digits += mantissa != 0;
+		}
+		else
+		{
+			exponent++;
+		}
+		c++;
+	}
+
+	if (c < end && *c == '.')
+	{
+		c++;
+		while (c < end && IsDigit(*c))
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*c - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+			c++;
+		}
+	}
+
+	if (c < end && (*c == 'e' || *c == 'E'))
+	{
+		c++;
+		exponent += ParseInt(c, end);
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0)
+		value /= PowerOfTen(-exponent);
+	else if (exponent > 0)
+		value *= PowerOfTen(exponent);
+
+	return (float)(negative ? -value : value);
+}
+
+bool ObjLoader::Load(const char* path, MeshData& data, unsigned int threadCount)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return Parse((const char*)file.GetData(), file.GetSize(), data, threadCount);
+}
+
+bool ObjLoader::Parse(const char* text, size_t size, MeshData& data, unsigned int threadCount)
+{
+	threadCount = Parallel::GetThreadCount(threadCount);
+	size_t chunkCount = size / MIN_CHUNK_SIZE + 1;
+	if (chunkCount > threadCount)
+		chunkCount = threadCount;
+
+	//Every chunk starts at the beginning of a line
+	std::vector<Chunk> chunks(chunkCount);
+	const char* end = text + size;
+	const char* begin = text;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* chunkEnd = i + 1 == chunkCount ? end : SkipLine(text + size * (i + 1) / chunkCount, end);
+		if (chunkEnd < begin)
+			chunkEnd = begin;
+
+		chunks[i].begin = begin;
+		chunks[i].end = chunkEnd;
+		begin = chunkEnd;
+	}
+
+	Parallel::For(chunkCount, (unsigned int)chunkCount, [&chunks](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; i++)
+			ParseChunk(chunks[i]);
+	});
+
+	std::vector<float> positions, uvs, normals;
+	Concatenate(positions, chunks, &Chunk::positions);
+	Concatenate(uvs, chunks, &Chunk::uvs);
+	Concatenate(normals, chunks, &Chunk::normals);
+
+	int totals[3] = { (int)(positions.size() / 3), (int)(uvs.size() / 2), (int)(normals.size() / 3) };
+
+	size_t cornerCount = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+		cornerCount += chunks[i].corners.size();
+
+	//Welding in file order keeps the vertex order independent of the chunks
+	WeldTable table(cornerCount / 4);
+	std::vector<unsigned int> indices;
+	indices.reserve(cornerCount);
+
+	int bases[3] = { 0, 0, 0 };
+	size_t skipped = 0;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const std::vector<Corner>& corners = chunks[i].corners;
+		for (size_t t = 0; t + 2 < corners.size(); t += 3)
+		{
+			int resolved[3][3];
+			bool valid = true;
+			for (int v = 0; v < 3; v++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					int index = corners[t + v].index[k];
+					if (index != MISSING && (corners[t + v].relative & (1 << k)))
+						index += bases[k];
+					if (index != MISSING && (index < 0 || index >= totals[k]))
+						index = MISSING;
+					resolved[v][k] = index;
+				}
+				valid = valid && resolved[v][0] != MISSING;
+			}
+
+			if (!valid)
+			{
+				skipped++;
+				continue;
+			}
+
+			for (int v = 0; v < 3; v++)
+				indices.push_back(table.Insert(resolved[v]));
+		}
+
+		bases[0] += (int)(chunks[i].positions.size() / 3);
+		bases[1] += (int)(chunks[i].uvs.size() / 2);
+		bases[2] += (int)(chunks[i].normals.size() / 3);
+
+		//Every corner of the chunk is welded into indices, its parsed corners are freed to keep the peak memory down
+		std::vector<Corner>().swap(chunks[i].corners);
+	}
+
+	if (skipped > 0)
+		printf("%zu OBJ faces point to missing positions, they are skipped!\n", skipped);
+
+	if (indices.empty())
+	{
+		printf("OBJ file has no faces!\n");
+		return false;
+	}
+
+	const std::vector<Corner>& vertices = table.GetVertices();
+	bool hasNormals = !normals.empty();
+	bool hasUVs = !uvs.empty();
+
+	data = MeshData();
+	data.layout.AddAttribute<Attribute<VertexLayout::POSITION_LOCATION, Float3Format> >(0);
+	if (hasNormals)
+		data.layout.AddAttribute<Attribute<VertexLayout::NORMAL_LOCATION, Snorm10Format> >(1);
+	if (hasUVs)
+		data.layout.AddAttribute<Attribute<VertexLayout::UV_LOCATION, Half2Format> >(1);
+
+	data.numOfVertices = (unsigned int)vertices.size();
+	data.streams.resize(data.layout.GetStreamCount());
+	for (GLuint i = 0; i < data.layout.GetStreamCount(); i++)
+		data.streams[i].resize(data.layout.GetStreamSize(i, data.numOfVertices));
+
+	//Every vertex is written on its own, so the streams are filled in parallel
+	Parallel::For(vertices.size(), threadCount, [&](size_t first, size_t last, unsigned int)
+	{
+		float* positionStream = (float*)data.streams[0].data();
+		GLuint* attributeStream = hasNormals || hasUVs ? (GLuint*)data.streams[1].data() : nullptr;
+		size_t attributeWords = (hasNormals ? 1 : 0) + (hasUVs ? 1 : 0);
+
+		for (size_t v = first; v < last; v++)
+		{
+			const int* index = vertices[v].index;
+			positionStream[v * 3 + 0] = positions[index[0] * 3 + 0];
+			positionStream[v * 3 + 1] = positions[index[0] * 3 + 1];
+			positionStream[v * 3 + 2] = positions[index[0] * 3 + 2];
+
+			GLuint* attributes = attributeStream + v * attributeWords;
+			if (hasNormals)
+			{
+				glm::vec3 normal(0.0f);
+				if (index[2] != MISSING)
+					normal = glm::vec3(normals[index[2] * 3 + 0], normals[index[2] * 3 + 1], normals[index[2] * 3 + 2]);
+
+				float length = glm::length(normal);
+				*attributes++ = VertexLayout::PackNormal(length > 0.0f ? normal / length : normal);
+			}
+			if (hasUVs)
+			{
+				glm::vec2 uv(0.0f);
+				if (index[1] != MISSING)
+					uv = glm::vec2(uvs[index[1] * 2 + 0], uvs[index[1] * 2 + 1]);
+
+				*attributes++ = VertexLayout::PackUV(uv);
+			}
+		}
+	});
+
+	data.SetIndices(indices.data(), (unsigned int)indices.size());
+	return true;
+}
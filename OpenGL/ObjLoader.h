@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "MeshData.h"
+
+/*
+Loads Wavefront OBJ files into a MeshData, ready for Mesh::CreateMesh or a MeshUploader.
+
+The file is mapped into memory and cut into chunks on line boundaries, each chunk is parsed by its own thread.
+Corners using the same position, texture coordinate and normal are welded into one vertex.
+The result is the same whatever the number of threads.
+
+The vertices are stored in two streams:
+	stream 0 - position as 3 floats at VertexLayout::POSITION_LOCATION
+	stream 1 - normal (Snorm10Format, NORMAL_LOCATION) then texture coordinate (Half2Format, UV_LOCATION),
+	           each only when the file has some
+Only the geometry is read: faces with more than 3 corners are split into triangles, groups and materials are ignored.
+*/
+namespace ObjLoader
+{
+	/**
+	* Loads an OBJ file.
+	*
+	* @param threadCount Threads parsing the file, 0 for one per core
+	* @return false when the file can not be read or has no faces
+	*/
+	bool Load(const char* path, MeshData& data, unsigned int threadCount = 0);
+
+	/**
+	* Parses the text of an OBJ file already in memory.
+	*/
+	bool Parse(const char* text, size_t size, MeshData& data, unsigned int threadCount = 0);
+
+	/**
+	* Reads a decimal number and moves cursor past it, a lot quicker than strtof as it ignores the locale
+	* and exotic formats (hexadecimal, inf, nan). The result is the nearest float in all but rare cases.
+	*/
+	float ParseFloat(const char*& cursor, const char* end);
+}
@@ -0,0 +1,310 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#include "Simd.h"
+
+namespace
+{
+	//A vertex is in front of the near plane when z + w >= 0
+	inline float NearDistance(const glm::vec4& clip)
+	{
+		return clip.z + clip.w;
+	}
+
+	//Clip space to pixels, x and y in pixels from the bottom left corner, z from 0 (near) to 1 (far)
+	inline glm::vec3 ToScreen(const glm::vec4& clip, float width, float height)
+	{
+		float inverseW = 1.0f / clip.w;
+		return glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height, clip.z * inverseW * 0.5f + 0.5f);
+	}
+
+	//An edge function A * x + B * y + C, positive on the inner side of a counter clockwise edge from a to b
+	struct Edge
+	{
+		float a, b, c;
+
+		Edge(const glm::vec3& from, const glm::vec3& to)
+		{
+			a = from.y - to.y;
+			b = to.x - from.x;
+			c = -(a * from.x + b * from.y);
+		}
+	};
+}
+
+OcclusionCuller::OcclusionCuller()
+{
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+	viewProjection = glm::mat4(1.0f);
+}
+
+bool OcclusionCuller::CreateCuller(unsigned int width, unsigned int height)
+{
+	ClearCuller();
+	if (width == 0 || height == 0)
+	{
+		printf("Occlusion culler can not be created with a size of %u x %u!\n", width, height);
+		return false;
+	}
+
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	this->width = tilesX * TILE_SIZE;
+	this->height = tilesY * TILE_SIZE;
+
+	depth.assign((size_t)this->width * this->height, 1.0f);
+	tileDepth.assign((size_t)tilesX * tilesY, 1.0f);
+	return true;
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(tileDepth.begin(), tileDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::RenderOccluder(const float* positions, size_t positionStride, const unsigned int* indices, size_t numOfIndices,
+	const glm::mat4& model)
+{
+	if (depth.empty())
+		return;
+
+	glm::mat4 matrix = viewProjection * model;
+	float screenWidth = (float)width, screenHeight = (float)height;
+
+	for (size_t i = 0; i + 2 < numOfIndices; i += 3)
+	{
+		glm::vec4 clip[3];
+		float distances[3];
+		for (int v = 0; v < 3; v++)
+		{
+			const float* position = (const float*)((const char*)positions + positionStride * indices[i + v]);
+			clip[v] = matrix * glm::vec4(position[0], position[1], position[2], 1.0f);
+			distances[v] = NearDistance(clip[v]);
+		}
+
+		//Completely outside one side of the screen
+		if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+			(clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+			(clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+			(clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w))
+			continue;
+
+		if (distances[0] >= 0.0f && distances[1] >= 0.0f && distances[2] >= 0.0f)
+		{
+			RasterizeTriangle(ToScreen(clip[0], screenWidth, screenHeight), ToScreen(clip[1], screenWidth, screenHeight),
+				ToScreen(clip[2], screenWidth, screenHeight));
+			continue;
+		}
+
+		//Cut against the near plane, what is left is a triangle or a quad
+		glm::vec4 polygon[4];
+		int count = 0;
+		for (int v = 0; v < 3; v++)
+		{
+			int next = (v + 1) % 3;
+			if (distances[v] >= 0.0f)
+				polygon[count++] = clip[v];
+			if ((distances[v] >= 0.0f) != (distances[next] >= 0.0f))
+			{
+				float t = distances[v] / (distances[v] - distances[next]);
+				polygon[count++] = clip[v] + (clip[next] - clip[v]) * t;
+			}
+		}
+
+		for (int v = 1; v + 1 < count; v++)
+		{
+			RasterizeTriangle(ToScreen(polygon[0], screenWidth, screenHeight), ToScreen(polygon[v], screenWidth, screenHeight),
+				ToScreen(polygon[v + 1], screenWidth, screenHeight));
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+{
+	//Twice the area, negative or 0 for triangles facing away or seen edge on
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (!(area > 0.0f))
+		return;
+
+	//Pixels whose centre may be inside, in whole groups of 4 along x
+	float minX = std::max(std::min(std::min(v0.x, v1.x), v2.x), 0.0f);
+	float maxX = std::min(std::max(std::max(v0.x, v1.x), v2.x), (float)width - 1.0f);
+	float minY = std::max(std::min(std::min(v0.y, v1.y), v2.y), 0.0f);
+	float maxY = std::min(std::max(std::max(v0.y, v1.y), v2.y), (float)height - 1.0f);
+	if (minX > maxX || minY > maxY)
+		return;
+
+	int x0 = (int)minX & ~3, x1 = (int)maxX;
+	int y0 = (int)minY, y1 = (int)maxY;
+
+	//Each edge is 0 on the vertex in front of it, so edge / area is the weight of that vertex
+	Edge e0(v1, v2), e1(v2, v0), e2(v0, v1);
+
+	//Depth is linear across the screen after the perspective divide
+	float inverseArea = 1.0f / area;
+	float zA = (e0.a * v0.z + e1.a * v1.z + e2.a * v2.z) * inverseArea;
+	float zB = (e0.b * v0.z + e1.b * v1.z + e2.b * v2.z) * inverseArea;
+	float zC = (e0.c * v0.z + e1.c * v1.z + e2.c * v2.z) * inverseArea;
+
+#ifdef SIMD_SSE2
+	__m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 zero = _mm_setzero_ps();
+	__m128 stepE0 = _mm_set1_ps(e0.a * 4.0f), stepE1 = _mm_set1_ps(e1.a * 4.0f), stepE2 = _mm_set1_ps(e2.a * 4.0f);
+	__m128 stepZ = _mm_set1_ps(zA * 4.0f);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float centreY = (float)y + 0.5f;
+		__m128 x = _mm_add_ps(_mm_set1_ps((float)x0), lane);
+
+		__m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.a), x), _mm_set1_ps(e0.b * centreY + e0.c));
+		__m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.a), x), _mm_set1_ps(e1.b * centreY + e1.c));
+		__m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.a), x), _mm_set1_ps(e2.b * centreY + e2.c));
+		__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), x), _mm_set1_ps(zB * centreY + zC));
+
+		float* row = &depth[(size_t)y * width];
+		for (int px = x0; px <= x1; px += 4)
+		{
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+			if (_mm_movemask_ps(inside) != 0)
+			{
+				__m128 current = _mm_loadu_ps(row + px);
+				__m128 nearest = _mm_min_ps(current, z);
+				_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+
+			w0 = _mm_add_ps(w0, stepE0);
+			w1 = _mm_add_ps(w1, stepE1);
+			w2 = _mm_add_ps(w2, stepE2);
+			z = _mm_add_ps(z, stepZ);
+		}
+	}
+#else
+	for (int y = y0; y <= y1; y++)
+	{
+		float centreY = (float)y + 0.5f;
+		float* row = &depth[(size_t)y * width];
+		for (int px = x0; px <= x1; px++)
+		{
+			float centreX = (float)px + 0.5f;
+			if (e0.a * centreX + e0.b * centreY + e0.c >= 0.0f && e1.a * centreX + e1.b * centreY + e1.c >= 0.0f &&
+				e2.a * centreX + e2.b * centreY + e2.c >= 0.0f)
+			{
+				row[px] = std::min(row[px], zA * centreX + zB * centreY + zC);
+			}
+		}
+	}
+#endif
+}
+
+void OcclusionCuller::Finish()
+{
+	for (unsigned int ty = 0; ty < tilesY; ty++)
+	{
+		for (unsigned int tx = 0; tx < tilesX; tx++)
+		{
+			const float* tile = &depth[(size_t)ty * TILE_SIZE * width + tx * TILE_SIZE];
+#ifdef SIMD_SSE2
+			__m128 farthest = _mm_setzero_ps();
+			for (unsigned int y = 0; y < TILE_SIZE; y++)
+			{
+				const float* row = tile + (size_t)y * width;
+				farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+			}
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+			tileDepth[(size_t)ty * tilesX + tx] = _mm_cvtss_f32(farthest);
+#else
+			float farthest = 0.0f;
+			for (unsigned int y = 0; y < TILE_SIZE; y++)
+			{
+				for (unsigned int x = 0; x < TILE_SIZE; x++)
+					farthest = std::max(farthest, tile[(size_t)y * width + x]);
+			}
+			tileDepth[(size_t)ty * tilesX + tx] = farthest;
+#endif
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const Bounds& worldBounds) const
+{
+	if (depth.empty() || worldBounds.IsEmpty())
+		return true;
+
+	//Rectangle and nearest depth of the 8 corners on screen
+	float minX = (float)width, maxX = -1.0f, minY = (float)height, maxY = -1.0f, nearest = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? worldBounds.max.x : worldBounds.min.x, (i & 2) ? worldBounds.max.y : worldBounds.min.y,
+			(i & 4) ? worldBounds.max.z : worldBounds.min.z);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+		if (NearDistance(clip) < 0.0f || clip.w <= 0.0f)
+			return true;
+
+		glm::vec3 screen = ToScreen(clip, (float)width, (float)height);
+		minX = std::min(minX, screen.x);
+		maxX = std::max(maxX, screen.x);
+		minY = std::min(minY, screen.y);
+		maxY = std::max(maxY, screen.y);
+		nearest = std::min(nearest, screen.z);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+		return false;
+
+	//Every pixel the rectangle touches, even partly
+	int x0 = std::max((int)floorf(minX), 0), x1 = std::min((int)floorf(maxX), (int)width - 1);
+	int y0 = std::max((int)floorf(minY), 0), y1 = std::min((int)floorf(maxY), (int)height - 1);
+
+	for (int ty = y0 / (int)TILE_SIZE; ty <= y1 / (int)TILE_SIZE; ty++)
+	{
+		for (int tx = x0 / (int)TILE_SIZE; tx <= x1 / (int)TILE_SIZE; tx++)
+		{
+			//The whole tile is in front of the box
+			if (tileDepth[(size_t)ty * tilesX + tx] < nearest)
+				continue;
+
+			int tileX0 = tx * (int)TILE_SIZE, tileY0 = ty * (int)TILE_SIZE;
+			int tileX1 = tileX0 + (int)TILE_SIZE - 1, tileY1 = tileY0 + (int)TILE_SIZE - 1;
+			if (x0 <= tileX0 && tileX1 <= x1 && y0 <= tileY0 && tileY1 <= y1)
+				return true;
+
+			//The tile is only partly covered, its farthest pixel may be outside the box
+			for (int y = std::max(y0, tileY0); y <= std::min(y1, tileY1); y++)
+			{
+				const float* row = &depth[(size_t)y * width];
+				for (int x = std::max(x0, tileX0); x <= std::min(x1, tileX1); x++)
+				{
+					if (row[x] >= nearest)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionCuller::ClearCuller()
+{
+	std::vector<float>().swap(depth);
+	std::vector<float>().swap(tileDepth);
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	ClearCuller();
+}
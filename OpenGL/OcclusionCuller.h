@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+/*
+Hides objects behind big occluders (walls, buildings, terrain) on the CPU, before they are drawn.
+
+A few simple occluder meshes are rasterized each frame into a small depth buffer, 4 pixels at a time with
+SSE2. The farthest depth of every 8x8 tile is kept on top of it, so most objects are settled by a handful of
+tiles: an object is hidden when its nearest point is behind the depth of every pixel its box covers.
+
+Nothing is read back from the GPU, so the answer does not wait on it and is the same on every driver.
+Run it after frustum culling (FrustumCuller, SceneBvh), on the objects that are left.
+*/
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+
+	/**
+	* Allocates the depth buffer, a few hundred pixels across are enough.
+	*
+	* @param width Rounded up to a multiple of TILE_SIZE
+	* @param height Rounded up to a multiple of TILE_SIZE
+	* @return false when a size is 0
+	*/
+	bool CreateCuller(unsigned int width, unsigned int height);
+
+	/**
+	* Clears the depth buffer for a new frame.
+	*
+	* @param viewProjection projection * view of the camera, the same one objects are culled against
+	*/
+	void Begin(const glm::mat4& viewProjection);
+
+	/**
+	* Rasterizes an occluder. Triangles facing away are skipped (counter clockwise is front, as in OpenGL),
+	* so occluders should be closed and drawn as their simplest shape, inside the mesh they stand for.
+	*
+	* @param positions Position of the first vertex, 3 floats
+	* @param positionStride Bytes from one position to the next
+	* @param model The model matrix the occluder is drawn with
+	*/
+	void RenderOccluder(const float* positions, size_t positionStride, const unsigned int* indices, size_t numOfIndices, const glm::mat4& model);
+
+	/**
+	* Builds the tile depths, after the last occluder and before the first IsVisible.
+	*/
+	void Finish();
+
+	/**
+	* @param worldBounds The bounds in world space, see Mesh::GetWorldBounds
+	* @return false when every pixel the box covers is in front of it, or the box is off screen.
+	* Boxes crossing the near plane are always visible.
+	*/
+	bool IsVisible(const Bounds& worldBounds) const;
+
+	unsigned int GetWidth() const { return width; }
+	unsigned int GetHeight() const { return height; }
+
+	//Depth of every pixel from 0 (near) to 1 (far), rows from the bottom of the screen, for debugging
+	const float* GetDepth() const { return depth.data(); }
+
+	/**
+	Frees the depth buffer.
+	It does NOT destroy the class OcclusionCuller.
+	*/
+	void ClearCuller();
+
+	~OcclusionCuller();
+
+	//Pixels on each side of the tiles of the hierarchy
+	static const unsigned int TILE_SIZE = 8;
+
+private:
+	unsigned int width, height;
+	unsigned int tilesX, tilesY;
+	glm::mat4 viewProjection;
+
+	std::vector<float> depth;
+	std::vector<float> tileDepth;		//farthest depth of every tile
+
+	void RasterizeTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+};
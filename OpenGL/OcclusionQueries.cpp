@@ -0,0 +1,237 @@
+#include "OcclusionQueries.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+OcclusionQueries::OcclusionQueries()
+{
+	frame = 1;
+	proxyVAO = 0;
+	proxyVBO = 0;
+	proxyIBO = 0;
+	uniformModel = -1;
+	viewProjection = glm::mat4(1.0f);
+	cullFace = false;
+	colorMask[0] = colorMask[1] = colorMask[2] = colorMask[3] = GL_TRUE;
+	depthMask = GL_TRUE;
+	conditionalRender = false;
+}
+
+void OcclusionQueries::CreateOcclusionQueries()
+{
+	//Only the box is recreated, the objects and their queries stay
+	ClearProxyBox();
+
+	//Cube from -1 to 1, scaled and moved onto each box
+	GLfloat vertices[] = {
+		-1.0f, -1.0f, -1.0f,
+		1.0f, -1.0f, -1.0f,
+		1.0f, 1.0f, -1.0f,
+		-1.0f, 1.0f, -1.0f,
+		-1.0f, -1.0f, 1.0f,
+		1.0f, -1.0f, 1.0f,
+		1.0f, 1.0f, 1.0f,
+		-1.0f, 1.0f, 1.0f
+	};
+
+	GLubyte indices[] = {
+		4, 5, 6, 4, 6, 7,	//front
+		1, 0, 3, 1, 3, 2,	//back
+		0, 4, 7, 0, 7, 3,	//left
+		5, 1, 2, 5, 2, 6,	//right
+		7, 6, 2, 7, 2, 3,	//top
+		0, 1, 5, 0, 5, 4	//bottom
+	};
+
+	glGenVertexArrays(1, &proxyVAO);
+	glBindVertexArray(proxyVAO);
+
+	glGenBuffers(1, &proxyIBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, proxyIBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &proxyVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, proxyVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+unsigned int OcclusionQueries::AddObject()
+{
+	ObjectQueries object;
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+	{
+		glGenQueries(1, &object.ring[i].id);
+		object.ring[i].frame = 0;
+	}
+	object.visible = true;
+	object.resultFrame = 0;
+
+	objects.push_back(object);
+	return (unsigned int)objects.size() - 1;
+}
+
+void OcclusionQueries::BeginFrame()
+{
+	frame++;
+}
+
+void OcclusionQueries::BeginProxies(Shader& shader, const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+
+	//The boxes only test depth, they must not show or hide anything themselves
+	glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	//From inside a box only its back faces are left to pass
+	cullFace = glIsEnabled(GL_CULL_FACE) == GL_TRUE;
+	glDisable(GL_CULL_FACE);
+
+	shader.UseShader();
+	uniformModel = (GLint)shader.GetModelLocation();
+	glUniformMatrix4fv(shader.GetProjectionLocation(), 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+	glBindVertexArray(proxyVAO);
+}
+
+void OcclusionQueries::QueryBounds(unsigned int object, const Bounds& worldBounds)
+{
+	ObjectQueries& queries = objects[object];
+	Query& query = queries.ring[frame % RING_SIZE];
+	query.frame = 0;
+
+	//A box the near plane cuts loses its front faces, the query could fail while the object is right in front
+	bool crossesNear = worldBounds.IsEmpty();
+	for (int i = 0; i < 8 && !crossesNear; i++)
+	{
+		glm::vec3 corner((i & 1) ? worldBounds.max.x : worldBounds.min.x, (i & 2) ? worldBounds.max.y : worldBounds.min.y,
+			(i & 4) ? worldBounds.max.z : worldBounds.min.z);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+		crossesNear = clip.z + clip.w < 0.0f;
+	}
+
+	if (crossesNear)
+	{
+		queries.visible = true;
+		queries.resultFrame = frame;
+		return;
+	}
+
+	glm::vec3 centre = (worldBounds.min + worldBounds.max) * 0.5f;
+	glm::vec3 halfSize = (worldBounds.max - worldBounds.min) * 0.5f;
+	glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), centre), halfSize);
+	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
+
+	glBeginQuery(GL_ANY_SAMPLES_PASSED, query.id);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+	glEndQuery(GL_ANY_SAMPLES_PASSED);
+	query.frame = frame;
+}
+
+void OcclusionQueries::EndProxies()
+{
+	glBindVertexArray(0);
+
+	glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+	glDepthMask(depthMask);
+	if (cullFace)
+		glEnable(GL_CULL_FACE);
+}
+
+bool OcclusionQueries::WasVisible(unsigned int object)
+{
+	ObjectQueries& queries = objects[object];
+
+	//Newest first, an older result is worth nothing once a newer one is in
+	for (unsigned int age = 1; age <= RING_SIZE; age++)
+	{
+		if (frame < age)
+			break;
+
+		const Query& query = queries.ring[(frame - age) % RING_SIZE];
+		if (query.frame != frame - age || query.frame <= queries.resultFrame)
+			continue;
+
+		GLuint available = 0;
+		glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint passed = 0;
+		glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &passed);
+		queries.visible = passed != 0;
+		queries.resultFrame = query.frame;
+		break;
+	}
+
+	return queries.visible;
+}
+
+void OcclusionQueries::BeginConditionalRender(unsigned int object, GLenum mode)
+{
+	const Query& query = objects[object].ring[frame % RING_SIZE];
+	if (query.frame != frame)
+		return;
+
+	glBeginConditionalRender(query.id, mode);
+	conditionalRender = true;
+}
+
+void OcclusionQueries::EndConditionalRender()
+{
+	if (!conditionalRender)
+		return;
+
+	glEndConditionalRender();
+	conditionalRender = false;
+}
+
+void OcclusionQueries::ClearOcclusionQueries()
+{
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		for (unsigned int j = 0; j < RING_SIZE; j++)
+			glDeleteQueries(1, &objects[i].ring[j].id);
+	}
+	objects.clear();
+
+	ClearProxyBox();
+
+	frame = 1;
+	conditionalRender = false;
+}
+
+void OcclusionQueries::ClearProxyBox()
+{
+	if (proxyIBO != 0)
+	{
+		glDeleteBuffers(1, &proxyIBO);
+		proxyIBO = 0;
+	}
+
+	if (proxyVBO != 0)
+	{
+		glDeleteBuffers(1, &proxyVBO);
+		proxyVBO = 0;
+	}
+
+	if (proxyVAO != 0)
+	{
+		glDeleteVertexArrays(1, &proxyVAO);
+		proxyVAO = 0;
+	}
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+	ClearOcclusionQueries();
+}
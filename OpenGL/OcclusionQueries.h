@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Shader.h"
+
+/*
+Asks the GPU which objects are hidden, by drawing their bounding box after the occluders.
+
+Each box is drawn inside a GL_ANY_SAMPLES_PASSED query with colour and depth writes off, so it costs a few
+pixels of depth testing. The answer is used two ways:
+- WasVisible reads the newest query that has finished, from an earlier frame, and never waits for the GPU.
+Hidden objects are skipped on the CPU, and still get a box every frame so they come back once they show.
+- BeginConditionalRender wraps the draw of an expensive mesh, and the GPU drops it by itself when this frame's
+box did not pass, without the CPU ever seeing the result.
+
+Every object cycles through RING_SIZE queries, one per frame, so the query of a frame is not reused while the
+GPU may still be working on it. Unlike OcclusionCuller the occluders can be anything already in the depth buffer.
+*/
+class OcclusionQueries
+{
+public:
+	OcclusionQueries();
+
+	/**
+	* Creates the box drawn for every query. Objects already added keep their queries, so it can be called
+	* before or after AddObject, and again to recreate the box.
+	*/
+	void CreateOcclusionQueries();
+
+	/**
+	* Adds an object, it is visible until its first query has finished.
+	*
+	* @return The index of the object for the other calls
+	*/
+	unsigned int AddObject();
+
+	/**
+	* Starts a new frame, the queries issued before are now from earlier frames.
+	*/
+	void BeginFrame();
+
+	/**
+	* Sets up drawing the boxes, after the occluders are in the depth buffer.
+	*
+	* @param shader A shader with projection and model uniforms, such as Shaders/shader.vert
+	* @param viewProjection projection * view, given to the projection uniform
+	*/
+	void BeginProxies(Shader& shader, const glm::mat4& viewProjection);
+
+	/**
+	* Draws the box of an object inside its query for this frame.
+	* Boxes crossing the near plane or empty would give a wrong answer, they are marked visible instead.
+	*
+	* @param worldBounds The bounds in world space, see Mesh::GetWorldBounds
+	*/
+	void QueryBounds(unsigned int object, const Bounds& worldBounds);
+
+	/**
+	* Turns colour, depth writes and face culling back to what they were.
+	*/
+	void EndProxies();
+
+	/**
+	* @return The result of the newest finished query of the object, or the previous result when none has finished
+	*/
+	bool WasVisible(unsigned int object);
+
+	/**
+	* Draws between this and EndConditionalRender are dropped by the GPU when the box of the object did not pass
+	* this frame. Does nothing when the object has no query this frame.
+	*
+	* @param mode GL_QUERY_WAIT makes the GPU wait for the box, GL_QUERY_NO_WAIT draws anyway when it is not done
+	*/
+	void BeginConditionalRender(unsigned int object, GLenum mode = GL_QUERY_WAIT);
+
+	void EndConditionalRender();
+
+	size_t GetObjectCount() { return objects.size(); }
+
+	/**
+	Clear every query and the box from the GPU and sets them back to 0.
+	It does NOT destroy the class OcclusionQueries.
+	*/
+	void ClearOcclusionQueries();
+
+	~OcclusionQueries();
+
+	//Frames a query has to finish before its name is reused
+	static const unsigned int RING_SIZE = 3;
+
+private:
+	struct Query
+	{
+		GLuint id;
+		unsigned int frame;		//frame the query was issued in, 0 when it holds none
+	};
+
+	struct ObjectQueries
+	{
+		Query ring[RING_SIZE];
+		bool visible;
+		unsigned int resultFrame;	//frame the visible result comes from
+	};
+
+	std::vector<ObjectQueries> objects;
+	unsigned int frame;
+
+	GLuint proxyVAO, proxyVBO, proxyIBO;
+	GLint uniformModel;
+	glm::mat4 viewProjection;
+	bool cullFace;					//state BeginProxies changes, put back by EndProxies
+	GLboolean colorMask[4];
+	GLboolean depthMask;
+	bool conditionalRender;
+
+	void ClearProxyBox();
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+/*
+Splits loops across threads.
+*/
+namespace Parallel
+{
+	/**
+	* @param requested Threads asked for, 0 for one per core
+	* @return At least 1
+	*/
+	inline unsigned int GetThreadCount(unsigned int requested)
+	{
+		if (requested == 0)
+			requested = std::thread::hardware_concurrency();
+		return requested > 0 ? requested : 1;
+	}
+
+	/**
+	* Cuts [0, count) into one contiguous range per thread and calls function(begin, end, thread) for each range.
+	* The calling thread runs the first range itself. Returns once every range is done.
+	*
+	* @param threadCount Threads to use, 0 for one per core, never more than count
+	*/
+	template<typename Function>
+	void For(size_t count, unsigned int threadCount, Function function)
+	{
+		if (count == 0)
+			return;
+
+		threadCount = GetThreadCount(threadCount);
+		if (threadCount > count)
+			threadCount = (unsigned int)count;
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (unsigned int i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(function, count * i / threadCount, count * (i + 1) / threadCount, i));
+
+		function((size_t)0, count / threadCount, 0u);
+
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+}
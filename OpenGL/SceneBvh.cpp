@@ -0,0 +1,690 @@
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <float.h>
+#include <math.h>
+
+#include "Frustum.h"
+#include "Parallel.h"
+
+namespace
+{
+	//Nodes above it are split one at a time with every thread binning, below it whole subtrees go to one thread.
+	//A fixed size keeps the layout of the tree the same for any number of threads
+	const unsigned int SUBTREE_OBJECTS = 8192;
+
+	//Cost of visiting a node against testing one object
+	const float TRAVERSAL_COST = 1.0f;
+
+	struct Box
+	{
+		glm::vec3 min, max;
+
+		Box() : min(FLT_MAX), max(-FLT_MAX) {}
+
+		void Grow(const glm::vec3& point)
+		{
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+
+		void Grow(const Box& box)
+		{
+			min = glm::min(min, box.min);
+			max = glm::max(max, box.max);
+		}
+
+		float HalfArea() const
+		{
+			glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+	};
+
+	struct Bin
+	{
+		Box box;
+		unsigned int count;
+
+		Bin() : count(0) {}
+	};
+
+	//What the nodes above and beside a range need to know about it
+	struct RangeInfo
+	{
+		Box box;
+		Box centroidBox;
+		Bin bins[3][SceneBvh::BIN_COUNT];
+	};
+
+	struct Builder
+	{
+		std::vector<Box> boxes;				//empty bounds become boxes that grow nothing
+		std::vector<glm::vec3> centroids;
+		unsigned int* indices;
+		unsigned int threadCount;
+	};
+
+	struct Split
+	{
+		int axis;		//-1 to make a leaf
+		unsigned int bin;
+	};
+
+	inline Box BoxOf(const Bounds& bounds)
+	{
+		Box box;
+		if (!bounds.IsEmpty())
+		{
+			box.min = bounds.min;
+			box.max = bounds.max;
+		}
+		return box;
+	}
+
+	inline unsigned int BinOf(float centroid, float minimum, float scale)
+	{
+		int bin = (int)((centroid - minimum) * scale);
+		return (unsigned int)std::max(0, std::min((int)SceneBvh::BIN_COUNT - 1, bin));
+	}
+
+	void MeasureRange(const Builder& builder, size_t first, size_t last, Box& box, Box& centroidBox)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int object = builder.indices[i];
+			box.Grow(builder.boxes[object]);
+			centroidBox.Grow(builder.centroids[object]);
+		}
+	}
+
+	void BinRange(const Builder& builder, size_t first, size_t last, const Box& centroidBox, const glm::vec3& scale,
+		Bin (&bins)[3][SceneBvh::BIN_COUNT])
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int object = builder.indices[i];
+			const glm::vec3& centroid = builder.centroids[object];
+			const Box& box = builder.boxes[object];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				Bin& bin = bins[axis][BinOf(centroid[axis], centroidBox.min[axis], scale[axis])];
+				bin.box.Grow(box);
+				bin.count++;
+			}
+		}
+	}
+
+	//Bounds and bins of the objects [first, first + count). Min, max and sums do not depend on the order
+	//the threads are merged in, so parallel and serial give the same numbers
+	void Measure(const Builder& builder, size_t first, size_t count, unsigned int threadCount, RangeInfo& info, glm::vec3& scale)
+	{
+		if (threadCount <= 1)
+		{
+			MeasureRange(builder, first, first + count, info.box, info.centroidBox);
+		}
+		else
+		{
+			std::vector<Box> boxes(threadCount), centroidBoxes(threadCount);
+			Parallel::For(count, threadCount, [&](size_t begin, size_t end, unsigned int thread)
+			{
+				MeasureRange(builder, first + begin, first + end, boxes[thread], centroidBoxes[thread]);
+			});
+			for (unsigned int i = 0; i < threadCount; i++)
+			{
+				info.box.Grow(boxes[i]);
+				info.centroidBox.Grow(centroidBoxes[i]);
+			}
+		}
+
+		glm::vec3 extent = info.centroidBox.max - info.centroidBox.min;
+		for (int axis = 0; axis < 3; axis++)
+			scale[axis] = extent[axis] > 0.0f ? SceneBvh::BIN_COUNT / extent[axis] : 0.0f;
+
+		if (threadCount <= 1)
+		{
+			BinRange(builder, first, first + count, info.centroidBox, scale, info.bins);
+		}
+		else
+		{
+			std::vector<RangeInfo> threadInfos(threadCount);
+			Parallel::For(count, threadCount, [&](size_t begin, size_t end, unsigned int thread)
+			{
+				BinRange(builder, first + begin, first + end, info.centroidBox, scale, threadInfos[thread].bins);
+			});
+			for (unsigned int i = 0; i < threadCount; i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					for (unsigned int b = 0; b < SceneBvh::BIN_COUNT; b++)
+					{
+						info.bins[axis][b].box.Grow(threadInfos[i].bins[axis][b].box);
+						info.bins[axis][b].count += threadInfos[i].bins[axis][b].count;
+					}
+				}
+			}
+		}
+	}
+
+	//Sweeps the bins of every axis for the cheapest plane, against the cost of stopping here
+	Split FindSplit(const RangeInfo& info, size_t count)
+	{
+		Split split = { -1, 0 };
+		float nodeArea = info.box.HalfArea();
+		float bestCost = FLT_MAX;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (info.centroidBox.max[axis] <= info.centroidBox.min[axis])
+				continue;
+
+			const Bin* bins = info.bins[axis];
+			float rightCosts[SceneBvh::BIN_COUNT];
+			Box right;
+			unsigned int rightCount = 0;
+			for (unsigned int b = SceneBvh::BIN_COUNT - 1; b > 0; b--)
+			{
+				right.Grow(bins[b].box);
+				rightCount += bins[b].count;
+				rightCosts[b] = rightCount * right.HalfArea();
+			}
+
+			Box left;
+			unsigned int leftCount = 0;
+			for (unsigned int b = 0; b + 1 < SceneBvh::BIN_COUNT; b++)
+			{
+				left.Grow(bins[b].box);
+				leftCount += bins[b].count;
+				if (leftCount == 0 || leftCount == count)
+					continue;
+
+				float cost = leftCount * left.HalfArea() + rightCosts[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					split.axis = axis;
+					split.bin = b + 1;
+				}
+			}
+		}
+
+		if (split.axis < 0)
+			return split;
+
+		//Small leaves stay whole when splitting them costs more than testing their objects
+		float splitCost = TRAVERSAL_COST + (nodeArea > 0.0f ? bestCost / nodeArea : 0.0f);
+		if (count <= SceneBvh::MAX_LEAF_OBJECTS && splitCost >= (float)count)
+			split.axis = -1;
+
+		return split;
+	}
+
+	//Reorders the objects so the ones left of the split come first
+	size_t Partition(const Builder& builder, size_t first, size_t count, const RangeInfo& info, const glm::vec3& scale, const Split& split)
+	{
+		if (split.axis < 0)
+		{
+			//Every centroid in the same place, halve the range as it is
+			return count / 2;
+		}
+
+		int axis = split.axis;
+		unsigned int* begin = builder.indices + first;
+		unsigned int* middle = std::partition(begin, begin + count, [&](unsigned int object)
+		{
+			return BinOf(builder.centroids[object][axis], info.centroidBox.min[axis], scale[axis]) < split.bin;
+		});
+		return (size_t)(middle - begin);
+	}
+
+	//Splits a node once, returns false when it becomes a leaf
+	bool SplitNode(const Builder& builder, SceneBvh::Node& node, size_t first, size_t count, unsigned int threadCount, size_t& leftCount)
+	{
+		RangeInfo info;
+		glm::vec3 scale;
+		Measure(builder, first, count, threadCount, info, scale);
+		node.min = info.box.min;
+		node.max = info.box.max;
+
+		Split split = FindSplit(info, count);
+		if (split.axis < 0 && count <= SceneBvh::MAX_LEAF_OBJECTS)
+		{
+			node.leftOrFirst = (unsigned int)first;
+			node.count = (unsigned int)count;
+			return false;
+		}
+
+		leftCount = Partition(builder, first, count, info, scale, split);
+		node.count = 0;
+		return true;
+	}
+
+	//Builds a whole subtree depth first on the calling thread, its root is nodes[rootIndex]
+	void BuildSubtree(const Builder& builder, std::vector<SceneBvh::Node>& nodes, unsigned int rootIndex, size_t first, size_t count)
+	{
+		struct Task { unsigned int node; size_t first, count; };
+		std::vector<Task> stack;
+		stack.push_back({ rootIndex, first, count });
+
+		while (!stack.empty())
+		{
+			Task task = stack.back();
+			stack.pop_back();
+
+			size_t leftCount;
+			if (!SplitNode(builder, nodes[task.node], task.first, task.count, 1, leftCount))
+				continue;
+
+			unsigned int left = (unsigned int)nodes.size();
+			nodes[task.node].leftOrFirst = left;
+			nodes.resize(nodes.size() + 2);
+
+			//Right pushed first so the left child is built first
+			stack.push_back({ left + 1, task.first + leftCount, task.count - leftCount });
+			stack.push_back({ left, task.first, leftCount });
+		}
+	}
+
+	inline bool IntersectBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection,
+		float maxDistance, float& distance)
+	{
+		glm::vec3 t0 = (min - origin) * inverseDirection;
+		glm::vec3 t1 = (max - origin) * inverseDirection;
+		glm::vec3 entries = glm::min(t0, t1);
+		glm::vec3 exits = glm::max(t0, t1);
+
+		float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+		distance = enter;
+		return enter <= exit;
+	}
+
+	inline glm::vec3 InverseDirection(const glm::vec3& direction)
+	{
+		//Tiny instead of 0 keeps the slabs finite for rays parallel to an axis
+		glm::vec3 inverse;
+		for (int i = 0; i < 3; i++)
+			inverse[i] = 1.0f / (direction[i] != 0.0f ? direction[i] : (signbit(direction[i]) ? -1e-30f : 1e-30f));
+		return inverse;
+	}
+
+	//Bit set for every plane the box crosses, -1 when the box is outside one of them
+	inline int ClassifyBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max, int planeMask)
+	{
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			if (!(planeMask & (1 << p)))
+				continue;
+
+			const glm::vec4& plane = frustum.GetPlane(p);
+			glm::vec3 normal(plane);
+
+			//Corner furthest along the normal, and the one furthest against it
+			glm::vec3 positive(normal.x >= 0.0f ? max.x : min.x, normal.y >= 0.0f ? max.y : min.y, normal.z >= 0.0f ? max.z : min.z);
+			glm::vec3 negative(normal.x >= 0.0f ? min.x : max.x, normal.y >= 0.0f ? min.y : max.y, normal.z >= 0.0f ? min.z : max.z);
+
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+				return -1;
+			if (glm::dot(normal, negative) + plane.w >= 0.0f)
+				planeMask &= ~(1 << p);
+		}
+		return planeMask;
+	}
+}
+
+SceneBvh::SceneBvh()
+{
+}
+
+void SceneBvh::Build(const Bounds* objectBounds, size_t objectCount, unsigned int threadCount)
+{
+	ClearBvh();
+	if (objectCount == 0)
+		return;
+
+	objects.assign(objectBounds, objectBounds + objectCount);
+	objectIndices.resize(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+		objectIndices[i] = (unsigned int)i;
+
+	Builder builder;
+	builder.indices = objectIndices.data();
+	builder.threadCount = Parallel::GetThreadCount(threadCount);
+	builder.boxes.resize(objectCount);
+	builder.centroids.resize(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		builder.boxes[i] = BoxOf(objects[i]);
+		builder.centroids[i] = objects[i].IsEmpty() ? glm::vec3(0.0f) : (objects[i].min + objects[i].max) * 0.5f;
+	}
+
+	//Large nodes first, breadth first, every thread binning each of them
+	struct Task { unsigned int node; size_t first, count; };
+	std::vector<Task> subtrees;
+	std::vector<Task> queue;
+	queue.push_back({ 0, 0, objectCount });
+	nodes.resize(1);
+
+	for (size_t q = 0; q < queue.size(); q++)
+	{
+		Task task = queue[q];
+		if (task.count <= SUBTREE_OBJECTS)
+		{
+			subtrees.push_back(task);
+			continue;
+		}
+
+		unsigned int threads = task.count >= (size_t)SUBTREE_OBJECTS * 4 ? builder.threadCount : 1;
+		size_t leftCount;
+		if (!SplitNode(builder, nodes[task.node], task.first, task.count, threads, leftCount))
+			continue;
+
+		unsigned int left = (unsigned int)nodes.size();
+		nodes[task.node].leftOrFirst = left;
+		nodes.resize(nodes.size() + 2);
+		queue.push_back({ left, task.first, leftCount });
+		queue.push_back({ left + 1, task.first + leftCount, task.count - leftCount });
+	}
+
+	//Then the small subtrees, each into its own array by whichever thread is free
+	std::vector<std::vector<Node> > subtreeNodes(subtrees.size());
+	std::atomic<size_t> nextSubtree(0);
+	unsigned int subtreeThreads = (unsigned int)std::min<size_t>(builder.threadCount, subtrees.size());
+	Parallel::For(subtreeThreads, subtreeThreads, [&](size_t, size_t, unsigned int)
+	{
+		for (size_t s = nextSubtree++; s < subtrees.size(); s = nextSubtree++)
+		{
+			subtreeNodes[s].resize(1);
+			BuildSubtree(builder, subtreeNodes[s], 0, subtrees[s].first, subtrees[s].count);
+		}
+	});
+
+	//Appended in order, the root of each takes the place waiting for it in the top of the tree
+	for (size_t s = 0; s < subtrees.size(); s++)
+	{
+		const std::vector<Node>& local = subtreeNodes[s];
+		unsigned int base = (unsigned int)nodes.size() - 1;
+		for (size_t i = 0; i < local.size(); i++)
+		{
+			Node node = local[i];
+			if (node.count == 0)
+				node.leftOrFirst += base;
+
+			if (i == 0)
+				nodes[subtrees[s].node] = node;
+			else
+				nodes.push_back(node);
+		}
+	}
+
+	parents.assign(nodes.size(), 0);
+	objectLeaves.resize(objectCount);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		const Node& node = nodes[i];
+		if (node.count == 0)
+		{
+			parents[node.leftOrFirst] = (unsigned int)i;
+			parents[node.leftOrFirst + 1] = (unsigned int)i;
+		}
+		else
+		{
+			for (unsigned int j = 0; j < node.count; j++)
+				objectLeaves[objectIndices[node.leftOrFirst + j]] = (unsigned int)i;
+		}
+	}
+
+	dirtyFlags.assign(nodes.size(), 0);
+}
+
+void SceneBvh::Update(unsigned int object, const Bounds& worldBounds)
+{
+	objects[object] = worldBounds;
+
+	unsigned int leaf = objectLeaves[object];
+	if (!dirtyFlags[leaf])
+	{
+		dirtyFlags[leaf] = 1;
+		dirtyNodes.push_back(leaf);
+	}
+}
+
+void SceneBvh::Refit()
+{
+	if (dirtyNodes.empty())
+		return;
+
+	//Every node above a changed leaf, once
+	size_t leafCount = dirtyNodes.size();
+	for (size_t i = 0; i < leafCount; i++)
+	{
+		unsigned int node = dirtyNodes[i];
+		while (node != 0)
+		{
+			node = parents[node];
+			if (dirtyFlags[node])
+				break;
+			dirtyFlags[node] = 1;
+			dirtyNodes.push_back(node);
+		}
+	}
+
+	//Children always come after their parent, so going backwards fits them first
+	std::sort(dirtyNodes.begin(), dirtyNodes.end(), [](unsigned int a, unsigned int b) { return a > b; });
+	for (size_t i = 0; i < dirtyNodes.size(); i++)
+	{
+		FitNode(dirtyNodes[i]);
+		dirtyFlags[dirtyNodes[i]] = 0;
+	}
+	dirtyNodes.clear();
+}
+
+void SceneBvh::FitNode(unsigned int index)
+{
+	Node& node = nodes[index];
+	Box box;
+	if (node.count == 0)
+	{
+		const Node& left = nodes[node.leftOrFirst];
+		const Node& right = nodes[node.leftOrFirst + 1];
+		box.min = glm::min(left.min, right.min);
+		box.max = glm::max(left.max, right.max);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < node.count; i++)
+			box.Grow(BoxOf(objects[objectIndices[node.leftOrFirst + i]]));
+	}
+	node.min = box.min;
+	node.max = box.max;
+}
+
+void SceneBvh::QueryFrustum(const glm::mat4& viewProjection, std::vector<unsigned int>& result) const
+{
+	if (nodes.empty())
+		return;
+
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection);
+
+	//Each node carries the planes its parent still crosses, 0 once it is completely inside
+	const int allPlanes = (1 << Frustum::PLANE_COUNT) - 1;
+	std::vector<std::pair<unsigned int, int> > stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, allPlanes));
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back().first;
+		int planeMask = stack.back().second;
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		if (planeMask != 0)
+		{
+			planeMask = ClassifyBox(frustum, node.min, node.max, planeMask);
+			if (planeMask < 0)
+				continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack.push_back(std::make_pair(node.leftOrFirst + 1, planeMask));
+			stack.push_back(std::make_pair(node.leftOrFirst, planeMask));
+			continue;
+		}
+
+		for (unsigned int i = 0; i < node.count; i++)
+		{
+			unsigned int object = objectIndices[node.leftOrFirst + i];
+			const Bounds& bounds = objects[object];
+			if (bounds.IsEmpty())
+				continue;
+			if (planeMask == 0 || ClassifyBox(frustum, bounds.min, bounds.max, planeMask) >= 0)
+				result.push_back(object);
+		}
+	}
+}
+
+bool SceneBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	glm::vec3 inverseDirection = InverseDirection(direction);
+	float closest = maxDistance;
+	bool found = false;
+
+	float distance;
+	if (!IntersectBox(nodes[0].min, nodes[0].max, origin, inverseDirection, closest, distance))
+		return false;
+
+	//Nodes waiting with where the ray enters them, skipped once something closer is found
+	std::vector<std::pair<unsigned int, float> > stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, distance));
+
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back().first;
+		float enter = stack.back().second;
+		stack.pop_back();
+		if (enter > closest)
+			continue;
+
+		const Node& node = nodes[index];
+		if (node.count > 0)
+		{
+			for (unsigned int i = 0; i < node.count; i++)
+			{
+				unsigned int object = objectIndices[node.leftOrFirst + i];
+				const Bounds& bounds = objects[object];
+				if (bounds.IsEmpty() || !IntersectBox(bounds.min, bounds.max, origin, inverseDirection, closest, distance))
+					continue;
+
+				//Ties go to the lowest object, so the answer does not depend on the tree
+				if (!found || distance < closest || (distance == closest && object < hit.object))
+				{
+					closest = distance;
+					hit.object = object;
+					hit.distance = distance;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		//The nearer child goes on top, so it is visited first
+		float leftDistance, rightDistance;
+		const Node& left = nodes[node.leftOrFirst];
+		const Node& right = nodes[node.leftOrFirst + 1];
+		bool hitLeft = IntersectBox(left.min, left.max, origin, inverseDirection, closest, leftDistance);
+		bool hitRight = IntersectBox(right.min, right.max, origin, inverseDirection, closest, rightDistance);
+
+		if (hitLeft && hitRight)
+		{
+			if (leftDistance <= rightDistance)
+			{
+				stack.push_back(std::make_pair(node.leftOrFirst + 1, rightDistance));
+				stack.push_back(std::make_pair(node.leftOrFirst, leftDistance));
+			}
+			else
+			{
+				stack.push_back(std::make_pair(node.leftOrFirst, leftDistance));
+				stack.push_back(std::make_pair(node.leftOrFirst + 1, rightDistance));
+			}
+		}
+		else if (hitLeft)
+		{
+			stack.push_back(std::make_pair(node.leftOrFirst, leftDistance));
+		}
+		else if (hitRight)
+		{
+			stack.push_back(std::make_pair(node.leftOrFirst + 1, rightDistance));
+		}
+	}
+
+	return found;
+}
+
+void SceneBvh::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<Hit>& result) const
+{
+	if (nodes.empty())
+		return;
+
+	glm::vec3 inverseDirection = InverseDirection(direction);
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	float distance;
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!IntersectBox(node.min, node.max, origin, inverseDirection, maxDistance, distance))
+			continue;
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.leftOrFirst + 1);
+			stack.push_back(node.leftOrFirst);
+			continue;
+		}
+
+		for (unsigned int i = 0; i < node.count; i++)
+		{
+			unsigned int object = objectIndices[node.leftOrFirst + i];
+			const Bounds& bounds = objects[object];
+			if (!bounds.IsEmpty() && IntersectBox(bounds.min, bounds.max, origin, inverseDirection, maxDistance, distance))
+			{
+				Hit hit = { object, distance };
+				result.push_back(hit);
+			}
+		}
+	}
+}
+
+Bounds SceneBvh::GetBounds() const
+{
+	if (nodes.empty() || nodes[0].min.x > nodes[0].max.x)
+		return Bounds();
+	return Bounds::FromBox(nodes[0].min, nodes[0].max);
+}
+
+void SceneBvh::ClearBvh()
+{
+	std::vector<Node>().swap(nodes);
+	std::vector<unsigned int>().swap(parents);
+	std::vector<unsigned int>().swap(objectIndices);
+	std::vector<unsigned int>().swap(objectLeaves);
+	std::vector<Bounds>().swap(objects);
+	std::vector<unsigned int>().swap(dirtyNodes);
+	std::vector<unsigned char>().swap(dirtyFlags);
+}
+
+SceneBvh::~SceneBvh()
+{
+	ClearBvh();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+/*
+Bounding volume hierarchy over the objects of a scene, for culling and picking without walking every object.
+
+Objects are identified by their index in the bounds given to Build. Nodes are split with the surface area
+heuristic over binned centroids; large scenes bin in parallel and build their subtrees on several threads,
+and the tree comes out the same whatever the number of threads.
+
+Objects that move keep their place in the tree: Update changes their bounds and Refit grows or shrinks only
+the nodes above them. The tree gets looser when objects travel far from where they were built, Build again
+then.
+*/
+class SceneBvh
+{
+public:
+	//A node of the tree, its two children are next to each other
+	struct Node
+	{
+		glm::vec3 min;
+		unsigned int leftOrFirst;	//first child when count is 0, first object of objectIndices otherwise
+		glm::vec3 max;
+		unsigned int count;			//objects in the leaf, 0 for inner nodes
+	};
+
+	//The closest object a ray hits
+	struct Hit
+	{
+		unsigned int object;
+		float distance;				//along the ray, in lengths of its direction, 0 when it starts inside
+	};
+
+	SceneBvh();
+
+	/**
+	* Builds the tree over every object, replacing the previous one.
+	*
+	* @param objectBounds The bounds of every object in world space (see Mesh::GetWorldBounds), empty bounds are never found
+	* @param threadCount Threads to use, 0 for one per core; worth it past tens of thousands of objects
+	*/
+	void Build(const Bounds* objectBounds, size_t objectCount, unsigned int threadCount = 0);
+
+	/**
+	* Changes the bounds of an object that has moved, the tree is only fixed by Refit.
+	*/
+	void Update(unsigned int object, const Bounds& worldBounds);
+
+	/**
+	* Recomputes the nodes above the objects changed since the last Refit, the others are not touched.
+	*/
+	void Refit();
+
+	/**
+	* Finds every object whose box is at least partly inside the planes of a matrix.
+	* Nodes completely inside give all their objects without testing them.
+	*
+	* @param viewProjection projection * view
+	* @param result Receives the objects, in tree order; it is NOT cleared first
+	*/
+	void QueryFrustum(const glm::mat4& viewProjection, std::vector<unsigned int>& result) const;
+
+	/**
+	* Finds the closest object whose box the ray goes through, for picking.
+	* Boxes are the only test: to pick against triangles, test the objects along the ray with QueryRay.
+	*
+	* @param direction Does not need to be unit length, distances are in lengths of it
+	* @param maxDistance Objects further along the ray are ignored
+	* @return false when no object is hit
+	*/
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+
+	/**
+	* Finds every object whose box the ray goes through before maxDistance, in no particular order.
+	*
+	* @param result Receives the objects and where the ray enters their box; it is NOT cleared first
+	*/
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<Hit>& result) const;
+
+	const Bounds& GetObjectBounds(unsigned int object) const { return objects[object]; }
+
+	//Bounds of every object together, empty before Build
+	Bounds GetBounds() const;
+
+	const std::vector<Node>& GetNodes() const { return nodes; }
+
+	size_t GetObjectCount() const { return objects.size(); }
+
+	/**
+	Frees the tree and the objects.
+	It does NOT destroy the class SceneBvh.
+	*/
+	void ClearBvh();
+
+	~SceneBvh();
+
+	//Objects a leaf holds at most, and the centroid bins each split is chosen from
+	static const unsigned int MAX_LEAF_OBJECTS = 4;
+	static const unsigned int BIN_COUNT = 16;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<unsigned int> parents;			//parent of every node, the root has itself
+	std::vector<unsigned int> objectIndices;	//objects in leaf order, each leaf takes a contiguous range
+	std::vector<unsigned int> objectLeaves;		//leaf holding every object
+	std::vector<Bounds> objects;
+
+	std::vector<unsigned int> dirtyNodes;
+	std::vector<unsigned char> dirtyFlags;		//1 for every node in dirtyNodes
+
+	void FitNode(unsigned int node);
+};
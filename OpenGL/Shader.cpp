@@ -59,6 +59,11 @@ GLuint Shader::GetModelLocation()
 	return uniformModel;
 }
 
+GLint Shader::GetUniformLocation(const char* name)
+{
+	return glGetUniformLocation(shaderID, name);
+}
+
 void Shader::UseShader()
 {
 	glUseProgram(shaderID);
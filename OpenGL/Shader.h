@@ -28,6 +28,9 @@ public:
 
 	GLuint GetModelLocation();
 
+	/*Location of any other uniform of the program, -1 if the program does not use it*/
+	GLint GetUniformLocation(const char* name);
+
 	void UseShader();
 
 	/**
@@ -0,0 +1,22 @@
+#version 330
+layout (location = 0) in vec3 pos;
+layout (location = 8) in uint instanceIndex;
+
+out vec4 vCol;
+
+uniform mat4 projection;
+
+//Model matrices of the whole batch, 4 texels (columns) per matrix
+uniform samplerBuffer instanceModels;
+
+void main()
+{
+	int column = int(instanceIndex) * 4;
+	mat4 model = mat4(texelFetch(instanceModels, column),
+		texelFetch(instanceModels, column + 1),
+		texelFetch(instanceModels, column + 2),
+		texelFetch(instanceModels, column + 3));
+
+	gl_Position = projection * model * vec4(pos, 1.0);
+	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+}
\ No newline at end of file
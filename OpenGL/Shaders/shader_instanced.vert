@@ -0,0 +1,13 @@
+#version 330
+layout (location = 0) in vec3 pos;
+layout (location = 4) in mat4 instanceModel;
+
+out vec4 vCol;
+
+uniform mat4 projection;
+
+void main()
+{
+	gl_Position = projection * instanceModel * vec4(pos, 1.0);
+	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+}
\ No newline at end of file
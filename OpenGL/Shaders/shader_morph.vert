@@ -0,0 +1,28 @@
+#version 330
+layout (location = 0) in vec3 pos;
+
+out vec4 vCol;
+
+uniform mat4 model;
+uniform mat4 projection;
+
+//Position moves of every target, one texel per vertex in the order the mesh is drawn (see MorphTargets)
+uniform samplerBuffer morphDeltas;
+
+//Only the targets with a weight: the first texel of each and how much of it to add
+uniform int morphOffsets[8];
+uniform float morphWeights[8];
+uniform int morphCount;
+
+//gl_VertexID counts from the start of the vertex buffer, a mesh in a GeometryArena starts further in
+uniform int morphBaseVertex;
+
+void main()
+{
+	vec3 position = pos;
+	for (int i = 0; i < morphCount; i++)
+		position += morphWeights[i] * texelFetch(morphDeltas, morphOffsets[i] + gl_VertexID - morphBaseVertex).xyz;
+
+	gl_Position = projection * model * vec4(position, 1.0);
+	vCol = vec4(clamp(position, 0.0f, 1.0f), 1.0f);
+}
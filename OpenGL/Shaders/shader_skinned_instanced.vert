@@ -0,0 +1,33 @@
+#version 330
+layout (location = 0) in vec3 pos;
+layout (location = 4) in mat4 instanceModel;
+layout (location = 10) in uvec4 joints;
+layout (location = 11) in vec4 weights;
+
+out vec4 vCol;
+
+uniform mat4 projection;
+
+//Skin matrices of every skeleton drawn this frame, 4 texels (columns) per bone (see BonePalette)
+uniform samplerBuffer bones;
+//First bone of the skeleton of the first copy, the skeletons of the copies follow each other
+uniform int boneBase;
+//Bones of one skeleton
+uniform int boneCount;
+
+mat4 Bone(uint joint)
+{
+	int column = (boneBase + gl_InstanceID * boneCount + int(joint)) * 4;
+	return mat4(texelFetch(bones, column),
+		texelFetch(bones, column + 1),
+		texelFetch(bones, column + 2),
+		texelFetch(bones, column + 3));
+}
+
+void main()
+{
+	mat4 skin = weights.x * Bone(joints.x) + weights.y * Bone(joints.y) + weights.z * Bone(joints.z) + weights.w * Bone(joints.w);
+
+	gl_Position = projection * instanceModel * skin * vec4(pos, 1.0);
+	vCol = vec4(clamp(pos, 0.0f, 1.0f), 1.0f);
+}
@@ -0,0 +1,36 @@
+#version 330
+layout (location = 0) in vec3 pos;
+layout (location = 4) in mat4 instanceModel;
+//First frame, frame count, frames per second and start time of the clip this copy plays (see VertexAnimation)
+layout (location = 12) in vec4 instanceClip;
+
+out vec4 vCol;
+
+uniform mat4 projection;
+
+//Position and normal of every vertex of every baked frame, 2 texels per vertex
+uniform samplerBuffer vatFrames;
+uniform int vatVertexCount;
+uniform float vatTime;
+
+void main()
+{
+	//Looping over the clip, between the two frames nearest to the time
+	float frame = mod((vatTime - instanceClip.w) * instanceClip.z, instanceClip.y);
+	//mod can round up to the frame count itself, which would read the first frame of the next clip
+	int frame0 = min(int(frame), int(instanceClip.y) - 1);
+	int frame1 = frame0 + 1 < int(instanceClip.y) ? frame0 + 1 : 0;
+	float blend = frame - float(frame0);
+
+	int texel0 = ((int(instanceClip.x) + frame0) * vatVertexCount + gl_VertexID) * 2;
+	int texel1 = ((int(instanceClip.x) + frame1) * vatVertexCount + gl_VertexID) * 2;
+
+	vec3 position = mix(texelFetch(vatFrames, texel0).xyz, texelFetch(vatFrames, texel1).xyz, blend);
+	//Opposite normals blend to 0 halfway, normalize must not get it
+	vec3 normal = mix(texelFetch(vatFrames, texel0 + 1).xyz, texelFetch(vatFrames, texel1 + 1).xyz, blend);
+	float normalLength = length(normal);
+	normal = normalLength > 0.0 ? normal / normalLength : vec3(0.0, 1.0, 0.0);
+
+	gl_Position = projection * instanceModel * vec4(position, 1.0);
+	vCol = vec4(normal * 0.5 + 0.5, 1.0f);
+}
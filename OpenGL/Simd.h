@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+Picks the vector code paths. SIMD_SSE2 is defined, with the SSE2 intrinsics included, when the compiler targets
+SSE2: always on x64, on x86 with /arch:SSE2 or above, and with -msse2 elsewhere.
+Code using it keeps a plain C++ path in the #else for every other target.
+*/
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
@@ -0,0 +1,378 @@
+#include "TangentSpace.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "Parallel.h"
+#include "Simd.h"
+
+namespace
+{
+#ifdef SIMD_SSE2
+	//x, y and z in the first 3 lanes of a register, the last lane stays 0
+	typedef __m128 Vector;
+
+	inline Vector Make(float x, float y, float z) { return _mm_setr_ps(x, y, z, 0.0f); }
+	inline Vector Load(const float* v) { return _mm_setr_ps(v[0], v[1], v[2], 0.0f); }
+	inline Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+	inline Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+	inline Vector Scale(Vector a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+
+	//Vectors kept in memory take 4 floats, so they load and store in one go
+	inline Vector LoadPadded(const float* v) { return _mm_loadu_ps(v); }
+	inline void StorePadded(float* destination, Vector v) { _mm_storeu_ps(destination, v); }
+
+	inline void Store(float* destination, Vector v)
+	{
+		float lanes[4];
+		_mm_storeu_ps(lanes, v);
+		destination[0] = lanes[0];
+		destination[1] = lanes[1];
+		destination[2] = lanes[2];
+	}
+
+	inline float Dot(Vector a, Vector b)
+	{
+		__m128 products = _mm_mul_ps(a, b);
+		__m128 sum = _mm_add_ss(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(products, products)));
+	}
+
+	inline Vector Cross(Vector a, Vector b)
+	{
+		__m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 zXY = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+		return _mm_shuffle_ps(zXY, zXY, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+#else
+	typedef glm::vec3 Vector;
+
+	inline Vector Make(float x, float y, float z) { return glm::vec3(x, y, z); }
+	inline Vector Load(const float* v) { return glm::vec3(v[0], v[1], v[2]); }
+	inline Vector Add(Vector a, Vector b) { return a + b; }
+	inline Vector Sub(Vector a, Vector b) { return a - b; }
+	inline Vector Scale(Vector a, float s) { return a * s; }
+
+	inline Vector LoadPadded(const float* v) { return glm::vec3(v[0], v[1], v[2]); }
+	inline void StorePadded(float* destination, Vector v) { destination[0] = v.x; destination[1] = v.y; destination[2] = v.z; destination[3] = 0.0f; }
+	inline void Store(float* destination, Vector v) { destination[0] = v.x; destination[1] = v.y; destination[2] = v.z; }
+
+	inline float Dot(Vector a, Vector b) { return glm::dot(a, b); }
+	inline Vector Cross(Vector a, Vector b) { return glm::cross(a, b); }
+#endif
+
+	inline Vector Normalize(Vector v, Vector fallback)
+	{
+		float lengthSquared = Dot(v, v);
+		return lengthSquared > 0.0f ? Scale(v, 1.0f / sqrtf(lengthSquared)) : fallback;
+	}
+
+	inline const float* Element(const float* first, size_t stride, unsigned int vertex)
+	{
+		return (const float*)((const char*)first + stride * vertex);
+	}
+
+	//A float as a number that sorts the same way, with 0 and -0 as one value and every NaN as one value.
+	//Comparing the floats themselves would break std::sort on a NaN, which is neither smaller nor larger than anything
+	inline unsigned int SortKey(float value)
+	{
+		if (value == 0.0f)
+			value = 0.0f;
+
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		if (value != value)
+			bits = 0x7FC00000u;
+
+		//Negative floats sort backwards as unsigned bits, flipping them all puts them in order below the positive ones
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	//Vertices sharing a position get the same point, sorting by position puts them next to each other (as MeshSimplifier does)
+	std::vector<unsigned int> WeldPositions(const float* positions, size_t positionStride, size_t numOfVertices)
+	{
+		std::vector<unsigned int> sortedVertices(numOfVertices);
+		std::vector<unsigned int> keys(numOfVertices * 3);
+		for (size_t v = 0; v < numOfVertices; v++)
+		{
+			sortedVertices[v] = (unsigned int)v;
+			const float* position = Element(positions, positionStride, (unsigned int)v);
+			for (size_t k = 0; k < 3; k++)
+				keys[v * 3 + k] = SortKey(position[k]);
+		}
+
+		std::sort(sortedVertices.begin(), sortedVertices.end(), [&keys](unsigned int a, unsigned int b)
+		{
+			const unsigned int* ka = &keys[(size_t)a * 3];
+			const unsigned int* kb = &keys[(size_t)b * 3];
+			if (ka[0] != kb[0]) return ka[0] < kb[0];
+			if (ka[1] != kb[1]) return ka[1] < kb[1];
+			return ka[2] < kb[2];
+		});
+
+		//Same keys is the same point, so 0 and -0 weld
+		std::vector<unsigned int> pointOf(numOfVertices);
+		for (size_t i = 0; i < numOfVertices; i++)
+		{
+			unsigned int v = sortedVertices[i];
+			if (i > 0 && memcmp(&keys[(size_t)v * 3], &keys[(size_t)sortedVertices[i - 1] * 3], sizeof(unsigned int) * 3) == 0)
+				pointOf[v] = pointOf[sortedVertices[i - 1]];
+			else
+				pointOf[v] = v;
+		}
+		return pointOf;
+	}
+
+	//The corners (places in the index buffer) of every vertex, in index buffer order: corners[start[v]] to corners[start[v + 1]]
+	//Summing in this order whatever the thread is what keeps the results independent of the thread count
+	void BuildCorners(const unsigned int* indices, size_t numOfIndices, const unsigned int* pointOf, size_t numOfVertices,
+		std::vector<unsigned int>& start, std::vector<unsigned int>& corners)
+	{
+		start.assign(numOfVertices + 1, 0);
+		for (size_t i = 0; i < numOfIndices; i++)
+			start[(pointOf != nullptr ? pointOf[indices[i]] : indices[i]) + 1]++;
+
+		for (size_t v = 0; v < numOfVertices; v++)
+			start[v + 1] += start[v];
+
+		std::vector<unsigned int> next(start.begin(), start.end() - 1);
+		corners.resize(numOfIndices);
+		for (size_t i = 0; i < numOfIndices; i++)
+			corners[next[pointOf != nullptr ? pointOf[indices[i]] : indices[i]]++] = (unsigned int)i;
+	}
+
+	std::vector<unsigned int> UnpackIndices(const MeshData& data)
+	{
+		std::vector<unsigned int> indices(data.numOfIndices);
+		for (unsigned int i = 0; i < data.numOfIndices; i++)
+			indices[i] = IndexFormat::Read(data.indices.data(), data.indexType, i);
+		return indices;
+	}
+
+	//Unit vectors go in Snorm10Format, in a stream of their own so the other streams stay untouched
+	void AddSnorm10Stream(MeshData& data, GLuint location, const std::vector<GLuint>& packed)
+	{
+		GLuint stream = data.layout.GetStreamCount();
+		data.layout.AddAttribute(location, Snorm10Format::components, Snorm10Format::type, Snorm10Format::normalized,
+			Snorm10Format::integer, Snorm10Format::size, stream);
+		data.SetStream(stream, packed.data());
+	}
+}
+
+void TangentSpace::GenerateNormals(float* normals, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+	size_t numOfVertices, unsigned int threadCount)
+{
+	size_t numOfTriangles = numOfIndices / 3;
+
+	//The cross product of two edges is as long as twice the area of the face, which gives the weighting for free
+	std::vector<float> faceNormals(numOfTriangles * 4);
+	Parallel::For(numOfTriangles, threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			Vector a = Load(Element(positions, positionStride, indices[t * 3]));
+			Vector b = Load(Element(positions, positionStride, indices[t * 3 + 1]));
+			Vector c = Load(Element(positions, positionStride, indices[t * 3 + 2]));
+			StorePadded(&faceNormals[t * 4], Cross(Sub(b, a), Sub(c, a)));
+		}
+	});
+
+	std::vector<unsigned int> pointOf = WeldPositions(positions, positionStride, numOfVertices);
+	std::vector<unsigned int> start, corners;
+	BuildCorners(indices, numOfTriangles * 3, pointOf.data(), numOfVertices, start, corners);
+
+	Parallel::For(numOfVertices, threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		Vector up = Make(0.0f, 0.0f, 1.0f);
+		for (size_t v = begin; v < end; v++)
+		{
+			unsigned int point = pointOf[v];
+			Vector sum = Make(0.0f, 0.0f, 0.0f);
+			for (unsigned int c = start[point]; c < start[point + 1]; c++)
+				sum = Add(sum, LoadPadded(&faceNormals[(corners[c] / 3) * 4]));
+
+			Store(normals + v * 3, Normalize(sum, up));
+		}
+	});
+}
+
+void TangentSpace::GenerateTangents(float* tangents, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+	const float* normals, size_t normalStride, const float* uvs, size_t uvStride, size_t numOfVertices, unsigned int threadCount)
+{
+	size_t numOfTriangles = numOfIndices / 3;
+
+	//Per face the directions u and v grow along, per corner the angle of the face there
+	std::vector<float> faceTangents(numOfTriangles * 4), faceBitangents(numOfTriangles * 4), cornerAngles(numOfTriangles * 3);
+	Parallel::For(numOfTriangles, threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		Vector zero = Make(0.0f, 0.0f, 0.0f);
+		for (size_t t = begin; t < end; t++)
+		{
+			Vector p[3];
+			const float* uv[3];
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = Load(Element(positions, positionStride, indices[t * 3 + k]));
+				uv[k] = Element(uvs, uvStride, indices[t * 3 + k]);
+			}
+
+			Vector edge1 = Sub(p[1], p[0]);
+			Vector edge2 = Sub(p[2], p[0]);
+			float du1 = uv[1][0] - uv[0][0], dv1 = uv[1][1] - uv[0][1];
+			float du2 = uv[2][0] - uv[0][0], dv2 = uv[2][1] - uv[0][1];
+			float determinant = du1 * dv2 - du2 * dv1;
+
+			//Only the directions are used, so the sign of the determinant is all that is needed of it.
+			//A face with no area in uv space has no direction to give
+			Vector tangent = zero, bitangent = zero;
+			if (determinant != 0.0f)
+			{
+				float sign = determinant > 0.0f ? 1.0f : -1.0f;
+				tangent = Scale(Sub(Scale(edge1, dv2), Scale(edge2, dv1)), sign);
+				bitangent = Scale(Sub(Scale(edge2, du1), Scale(edge1, du2)), sign);
+			}
+			StorePadded(&faceTangents[t * 4], tangent);
+			StorePadded(&faceBitangents[t * 4], bitangent);
+
+			for (int k = 0; k < 3; k++)
+			{
+				Vector toNext = Normalize(Sub(p[(k + 1) % 3], p[k]), zero);
+				Vector toPrevious = Normalize(Sub(p[(k + 2) % 3], p[k]), zero);
+				float cosine = std::min(std::max(Dot(toNext, toPrevious), -1.0f), 1.0f);
+				cornerAngles[t * 3 + k] = acosf(cosine);
+			}
+		}
+	});
+
+	std::vector<unsigned int> start, corners;
+	BuildCorners(indices, numOfTriangles * 3, nullptr, numOfVertices, start, corners);
+
+	Parallel::For(numOfVertices, threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		Vector zero = Make(0.0f, 0.0f, 0.0f);
+		for (size_t v = begin; v < end; v++)
+		{
+			const float* normalElement = Element(normals, normalStride, (unsigned int)v);
+			Vector normal = Load(normalElement);
+
+			Vector tangent = zero, bitangent = zero;
+			for (unsigned int c = start[v]; c < start[v + 1]; c++)
+			{
+				unsigned int corner = corners[c];
+				float angle = cornerAngles[corner];
+
+				//Only what lies along the surface at this vertex counts (Gram-Schmidt)
+				Vector faceTangent = LoadPadded(&faceTangents[(corner / 3) * 4]);
+				Vector faceBitangent = LoadPadded(&faceBitangents[(corner / 3) * 4]);
+				faceTangent = Normalize(Sub(faceTangent, Scale(normal, Dot(normal, faceTangent))), zero);
+				faceBitangent = Normalize(Sub(faceBitangent, Scale(normal, Dot(normal, faceBitangent))), zero);
+
+				tangent = Add(tangent, Scale(faceTangent, angle));
+				bitangent = Add(bitangent, Scale(faceBitangent, angle));
+			}
+
+			//Without any uv direction any vector along the surface does
+			Vector axis = fabsf(normalElement[0]) < 0.9f ? Make(1.0f, 0.0f, 0.0f) : Make(0.0f, 1.0f, 0.0f);
+			tangent = Normalize(tangent, Normalize(Cross(normal, axis), Make(1.0f, 0.0f, 0.0f)));
+
+			Store(tangents + v * 4, tangent);
+			tangents[v * 4 + 3] = Dot(Cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+		}
+	});
+}
+
+bool TangentSpace::AddNormals(MeshData& data, unsigned int threadCount)
+{
+	if (data.layout.FindAttribute(VertexLayout::NORMAL_LOCATION) != nullptr)
+		return true;
+
+	GLsizei positionStride = 0;
+	std::vector<const void*> streams = data.GetStreamPointers();
+	const float* positions = data.layout.FindPositions(streams.data(), positionStride);
+	if (positions == nullptr)
+	{
+		printf("Normals need positions stored as 3 floats!\n");
+		return false;
+	}
+
+	std::vector<unsigned int> indices = UnpackIndices(data);
+	std::vector<float> normals((size_t)data.numOfVertices * 3);
+	GenerateNormals(normals.data(), indices.data(), indices.size(), positions, positionStride, data.numOfVertices, threadCount);
+
+	std::vector<GLuint> packed(data.numOfVertices);
+	Parallel::For(packed.size(), threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t v = begin; v < end; v++)
+			packed[v] = VertexLayout::PackNormal(glm::vec3(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]));
+	});
+
+	AddSnorm10Stream(data, VertexLayout::NORMAL_LOCATION, packed);
+	return true;
+}
+
+bool TangentSpace::AddTangents(MeshData& data, unsigned int threadCount)
+{
+	if (data.layout.FindAttribute(VertexLayout::TANGENT_LOCATION) != nullptr)
+		return true;
+
+	if (data.layout.FindAttribute(VertexLayout::UV_LOCATION) == nullptr)
+	{
+		printf("Tangents need texture coordinates!\n");
+		return false;
+	}
+
+	if (!AddNormals(data, threadCount))
+		return false;
+
+	//Found after AddNormals, which may have moved the attributes
+	const VertexAttribute& normalAttribute = *data.layout.FindAttribute(VertexLayout::NORMAL_LOCATION);
+	const VertexAttribute& uvAttribute = *data.layout.FindAttribute(VertexLayout::UV_LOCATION);
+
+	GLsizei positionStride = 0;
+	std::vector<const void*> streams = data.GetStreamPointers();
+	const float* positions = data.layout.FindPositions(streams.data(), positionStride);
+	if (positions == nullptr)
+	{
+		printf("Tangents need positions stored as 3 floats!\n");
+		return false;
+	}
+
+	//Normals and texture coordinates read back as floats, whatever they are stored as
+	std::vector<float> normals((size_t)data.numOfVertices * 3), uvs((size_t)data.numOfVertices * 2);
+	Parallel::For(data.numOfVertices, threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		GLsizei normalStride = data.layout.GetStride(normalAttribute.stream);
+		GLsizei uvStride = data.layout.GetStride(uvAttribute.stream);
+		for (size_t v = begin; v < end; v++)
+		{
+			glm::vec3 normal = glm::vec3(VertexLayout::ReadAttribute(normalAttribute, data.streams[normalAttribute.stream].data() + normalStride * v));
+			normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec4 uv = VertexLayout::ReadAttribute(uvAttribute, data.streams[uvAttribute.stream].data() + uvStride * v);
+
+			normals[v * 3] = normal.x;
+			normals[v * 3 + 1] = normal.y;
+			normals[v * 3 + 2] = normal.z;
+			uvs[v * 2] = uv.x;
+			uvs[v * 2 + 1] = uv.y;
+		}
+	});
+
+	std::vector<unsigned int> indices = UnpackIndices(data);
+	std::vector<float> tangents((size_t)data.numOfVertices * 4);
+	GenerateTangents(tangents.data(), indices.data(), indices.size(), positions, positionStride, normals.data(), sizeof(float) * 3,
+		uvs.data(), sizeof(float) * 2, data.numOfVertices, threadCount);
+
+	std::vector<GLuint> packed(data.numOfVertices);
+	Parallel::For(packed.size(), threadCount, [&](size_t begin, size_t end, unsigned int)
+	{
+		for (size_t v = begin; v < end; v++)
+			packed[v] = VertexLayout::PackNormal(glm::vec3(tangents[v * 4], tangents[v * 4 + 1], tangents[v * 4 + 2]), tangents[v * 4 + 3]);
+	});
+
+	AddSnorm10Stream(data, VertexLayout::TANGENT_LOCATION, packed);
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "MeshData.h"
+
+/*
+Generates the normals and tangents a lit, normal mapped mesh needs when the file it came from has none.
+
+Normals are smooth: each vertex gets the sum of the faces around it, weighted by their area. Vertices sharing
+a position (split for another uv) are treated as one point, so uv seams do not show in the lighting.
+
+Tangents follow the MikkTSpace conventions normal maps are usually baked with: the uv direction of every face
+is projected on the vertex normal and weighted by the angle of the face at the vertex, w holds the sign of
+the bitangent (bitangent = cross(normal, tangent.xyz) * w). Unlike the reference implementation vertices are
+never split, so mirrored uvs meeting at one vertex give the tangent of the majority.
+
+Both are vectorized (see Simd.h) and spread over threads. Every vertex sums its faces
+in index buffer order, so the result is the same whatever the number of threads.
+*/
+namespace TangentSpace
+{
+	/**
+	* Computes smooth normals.
+	*
+	* @param normals Receives 3 floats per vertex, unit length, (0, 0, 1) for vertices of no triangle
+	* @param positions Position of the first vertex, 3 floats
+	* @param positionStride Bytes from one position to the next
+	* @param threadCount Threads to use, 0 for one per core
+	*/
+	void GenerateNormals(float* normals, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+		size_t numOfVertices, unsigned int threadCount = 0);
+
+	/**
+	* Computes tangents from normals and texture coordinates.
+	*
+	* @param tangents Receives 4 floats per vertex, xyz unit length and perpendicular to the normal, w 1 or -1
+	* @param normals Normal of the first vertex, 3 floats of unit length
+	* @param uvs Texture coordinate of the first vertex, 2 floats
+	*/
+	void GenerateTangents(float* tangents, const unsigned int* indices, size_t numOfIndices, const float* positions, size_t positionStride,
+		const float* normals, size_t normalStride, const float* uvs, size_t uvStride, size_t numOfVertices, unsigned int threadCount = 0);
+
+	/**
+	* Adds normals (Snorm10Format at VertexLayout::NORMAL_LOCATION) in a new stream of the data.
+	* Does nothing when the layout already has normals. Mesh::GENERATE_NORMALS calls it from MeshData::Prepare.
+	*
+	* @return false when the positions are not stored as 3 floats
+	*/
+	bool AddNormals(MeshData& data, unsigned int threadCount = 0);
+
+	/**
+	* Adds tangents (Snorm10Format at VertexLayout::TANGENT_LOCATION) in a new stream of the data, normals are added first
+	* when missing. Does nothing when the layout already has tangents. Mesh::GENERATE_TANGENTS calls it from MeshData::Prepare.
+	*
+	* @return false when the positions are not stored as 3 floats or there are no texture coordinates
+	*/
+	bool AddTangents(MeshData& data, unsigned int threadCount = 0);
+}
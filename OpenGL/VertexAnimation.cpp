@@ -0,0 +1,219 @@
+#include "VertexAnimation.h"
+
+#include <float.h>
+#include <stdio.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include "Parallel.h"
+
+VertexAnimation::VertexAnimation()
+{
+	vertexCount = 0;
+	frameCount = 0;
+	baking = false;
+	frameBuffer = 0;
+	frameTexture = 0;
+}
+
+void VertexAnimation::BeginBake(GLsizei numOfVertices, const glm::vec3* positions, const glm::vec3* normals, const glm::uvec4* joints, const glm::vec4* weights)
+{
+	ClearVertexAnimation();
+
+	vertexCount = numOfVertices;
+	bindPositions.assign(positions, positions + numOfVertices);
+	if (normals != nullptr)
+		bindNormals.assign(normals, normals + numOfVertices);
+	else
+		bindNormals.assign(numOfVertices, glm::vec3(0.0f, 1.0f, 0.0f));
+	bindJoints.assign(joints, joints + numOfVertices);
+	bindWeights.assign(weights, weights + numOfVertices);
+	baking = true;
+}
+
+GLint VertexAnimation::AddClip(const glm::mat4* skinMatrices, GLsizei boneCount, GLsizei frameCount, float framesPerSecond, unsigned int threadCount)
+{
+	if (!baking)
+	{
+		printf("A clip can only be added between BeginBake and FinishBake!\n");
+		return -1;
+	}
+
+	if (frameCount <= 0)
+	{
+		printf("A clip needs at least one frame, %d given!\n", frameCount);
+		return -1;
+	}
+
+	for (GLsizei i = 0; i < vertexCount; i++)
+	{
+		const glm::uvec4& joints = bindJoints[i];
+		if ((GLsizei)glm::max(glm::max(joints.x, joints.y), glm::max(joints.z, joints.w)) >= boneCount)
+		{
+			printf("Vertex %d uses a joint the clip does not have!\n", i);
+			return -1;
+		}
+	}
+
+	Clip clip;
+	clip.firstFrame = this->frameCount;
+	clip.frameCount = frameCount;
+	clip.framesPerSecond = framesPerSecond;
+
+	size_t firstTexel = bakedTexels.size();
+	size_t vertices = (size_t)frameCount * vertexCount;
+	bakedTexels.resize(firstTexel + vertices * 2);
+
+	//Each thread skins its own vertices of its own frames and keeps its own box
+	unsigned int threads = Parallel::GetThreadCount(threadCount);
+	std::vector<glm::vec3> threadMin(threads, glm::vec3(FLT_MAX)), threadMax(threads, glm::vec3(-FLT_MAX));
+	Parallel::For(vertices, threads, [&](size_t begin, size_t end, unsigned int thread)
+	{
+		glm::vec3 min = threadMin[thread], max = threadMax[thread];
+		for (size_t i = begin; i < end; i++)
+		{
+			size_t vertex = i % vertexCount;
+			const glm::mat4* bones = skinMatrices + (i / vertexCount) * boneCount;
+			const glm::uvec4& joints = bindJoints[vertex];
+			const glm::vec4& weights = bindWeights[vertex];
+
+			glm::mat4 skin = weights.x * bones[joints.x] + weights.y * bones[joints.y] + weights.z * bones[joints.z] + weights.w * bones[joints.w];
+			glm::vec3 position = glm::vec3(skin * glm::vec4(bindPositions[vertex], 1.0f));
+			glm::vec3 normal = glm::mat3(skin) * bindNormals[vertex];
+			//A degenerate skin keeps the up normal, the shader normalizes what it reads
+			float length = glm::length(normal);
+			normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+
+			bakedTexels[firstTexel + i * 2] = glm::packHalf4x16(glm::vec4(position, 1.0f));
+			bakedTexels[firstTexel + i * 2 + 1] = glm::packHalf4x16(glm::vec4(normal, 0.0f));
+		}
+		threadMin[thread] = min;
+		threadMax[thread] = max;
+	});
+
+	glm::vec3 min = bakedBounds.IsEmpty() ? glm::vec3(FLT_MAX) : bakedBounds.min;
+	glm::vec3 max = bakedBounds.IsEmpty() ? glm::vec3(-FLT_MAX) : bakedBounds.max;
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		min = glm::min(min, threadMin[i]);
+		max = glm::max(max, threadMax[i]);
+	}
+	if (min.x <= max.x)
+		bakedBounds = Bounds::FromBox(min, max);
+
+	this->frameCount += frameCount;
+	clips.push_back(clip);
+	return (GLint)clips.size() - 1;
+}
+
+bool VertexAnimation::FinishBake()
+{
+	baking = false;
+	bindPositions = std::vector<glm::vec3>();
+	bindNormals = std::vector<glm::vec3>();
+	bindJoints = std::vector<glm::uvec4>();
+	bindWeights = std::vector<glm::vec4>();
+
+	if (bakedTexels.empty())
+	{
+		printf("No clip was baked!\n");
+		return false;
+	}
+
+	//Texels past the limit of the driver read as 0, the clips would collapse to the origin instead of failing
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if (bakedTexels.size() > (size_t)maxTexels)
+	{
+		printf("The baked clips take %u texels, a texture buffer can only hold %d!\n", (unsigned int)bakedTexels.size(), maxTexels);
+		bakedTexels = std::vector<glm::uint64>();
+		return false;
+	}
+
+	glGenBuffers(1, &frameBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, frameBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::uint64) * bakedTexels.size(), bakedTexels.data(), GL_STATIC_DRAW);
+
+	glGenTextures(1, &frameTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, frameTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA16F, frameBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	bakedTexels = std::vector<glm::uint64>();
+	return true;
+}
+
+glm::vec4 VertexAnimation::GetInstanceClip(GLint clip, float startTime, float speed)
+{
+	//-1 is what AddClip gives back when it fails
+	if (clip < 0 || (size_t)clip >= clips.size())
+	{
+		printf("Clip %d was never baked, the first frame is shown instead!\n", clip);
+		return glm::vec4(0.0f, 1.0f, 0.0f, startTime);
+	}
+
+	const Clip& played = clips[clip];
+	return glm::vec4((float)played.firstFrame, (float)played.frameCount, played.framesPerSecond * speed, startTime);
+}
+
+VertexAnimation::Uniforms VertexAnimation::FindUniforms(Shader& shader)
+{
+	Uniforms uniforms;
+	uniforms.frames = shader.GetUniformLocation("vatFrames");
+	uniforms.vertexCount = shader.GetUniformLocation("vatVertexCount");
+	uniforms.time = shader.GetUniformLocation("vatTime");
+	return uniforms;
+}
+
+void VertexAnimation::Bind(const Uniforms& uniforms, float time)
+{
+	glActiveTexture(GL_TEXTURE0 + FRAME_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, frameTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(uniforms.frames, FRAME_TEXTURE_UNIT);
+	glUniform1i(uniforms.vertexCount, vertexCount);
+	glUniform1f(uniforms.time, time);
+}
+
+void VertexAnimation::Unbind()
+{
+	glActiveTexture(GL_TEXTURE0 + FRAME_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void VertexAnimation::ClearVertexAnimation()
+{
+	if (frameTexture != 0)
+	{
+		glDeleteTextures(1, &frameTexture);
+		frameTexture = 0;
+	}
+
+	if (frameBuffer != 0)
+	{
+		glDeleteBuffers(1, &frameBuffer);
+		frameBuffer = 0;
+	}
+
+	bindPositions.clear();
+	bindNormals.clear();
+	bindJoints.clear();
+	bindWeights.clear();
+	bakedTexels.clear();
+	clips.clear();
+	bakedBounds = Bounds();
+	vertexCount = 0;
+	frameCount = 0;
+	baking = false;
+}
+
+VertexAnimation::~VertexAnimation()
+{
+	ClearVertexAnimation();
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Shader.h"
+
+/*
+Skinned animations baked into a vertex animation texture, for crowds.
+
+The baker skins every vertex of a mesh for every frame of each clip once, on the CPU at load time, and stores
+the skinned positions and normals in one texture buffer, frame after frame. Drawing is then only a lookup:
+every copy drawn with Mesh::RenderMeshInstanced carries a vec4 (see GetInstanceClip) telling which clip it
+plays and when it started, and the vertex shader (see Shaders/shader_vat_instanced.vert) reads its vertex
+from the two nearest frames and blends them. No bone is computed per frame, for any number of characters.
+
+Every frame costs 16 bytes per vertex (half float position and normal), a 5000 vertex character with 10 clips
+of 30 frames takes 24 MB.
+*/
+class VertexAnimation
+{
+public:
+	struct Clip
+	{
+		GLint firstFrame;		//in every frame baked
+		GLsizei frameCount;
+		float framesPerSecond;
+	};
+
+	//Where the shader reads the frames from, see FindUniforms
+	struct Uniforms
+	{
+		GLint frames;			//samplerBuffer vatFrames
+		GLint vertexCount;		//int vatVertexCount
+		GLint time;				//float vatTime
+	};
+
+	VertexAnimation();
+
+	/**
+	* Starts baking the animations of a skinned mesh, the arrays are copied.
+	*
+	* @param numOfVertices Vertices of the mesh, in the order the mesh is drawn with
+	* @param positions Positions in the bind pose
+	* @param normals Normals in the bind pose, nullptr bakes (0, 1, 0) normals
+	* @param joints 4 joints of each vertex
+	* @param weights Their weights, adding up to 1
+	*/
+	void BeginBake(GLsizei numOfVertices, const glm::vec3* positions, const glm::vec3* normals, const glm::uvec4* joints, const glm::vec4* weights);
+
+	/**
+	* Skins and stores every frame of a clip.
+	*
+	* @param skinMatrices boneCount skin matrices for the first frame, then for the second... (see GlbModel::ComputeSkinMatrices)
+	* @param frameCount Frames of the clip, sampled framesPerSecond apart, the clip loops from the last to the first
+	* @param threadCount Threads skinning the frames, 0 for one per core
+	* @return The clip, for GetInstanceClip, -1 outside of BeginBake/FinishBake or without any frame
+	*/
+	GLint AddClip(const glm::mat4* skinMatrices, GLsizei boneCount, GLsizei frameCount, float framesPerSecond, unsigned int threadCount = 0);
+
+	/**
+	* Uploads every clip baked and frees the copies made on the CPU.
+	*
+	* @return false when no clip was added or the clips need more texels than GL_MAX_TEXTURE_BUFFER_SIZE
+	*/
+	bool FinishBake();
+
+	/**
+	* The per-instance vec4 of a copy playing a clip, for Mesh::RenderMeshInstanced.
+	*
+	* @param startTime Time the copy started playing, different times keep a crowd out of step
+	* @param speed 1 plays the clip as baked
+	* @return For a clip that was never baked, the first frame baked held still
+	*/
+	glm::vec4 GetInstanceClip(GLint clip, float startTime, float speed = 1.0f);
+
+	/**
+	* Finds the uniforms of a shader, once after it is created.
+	*/
+	static Uniforms FindUniforms(Shader& shader);
+
+	/**
+	* Binds the frames for the shader in use.
+	*
+	* @param time Time of the frame drawn, in the same unit as the start times of the instances
+	*/
+	void Bind(const Uniforms& uniforms, float time);
+
+	void Unbind();
+
+	/**
+	* Box around every frame baked, for Mesh::SetBounds.
+	*/
+	Bounds GetBakedBounds() { return bakedBounds; }
+
+	const std::vector<Clip>& GetClips() { return clips; }
+	GLsizei GetFrameCount() { return frameCount; }
+
+	/**
+	Clear all buffers from the GPU and sets them back to 0.
+	It does NOT destroy the class VertexAnimation.
+	*/
+	void ClearVertexAnimation();
+
+	~VertexAnimation();
+
+	//Texture unit the frames are bound to, after MorphTargets::DELTA_TEXTURE_UNIT
+	static const GLint FRAME_TEXTURE_UNIT = 3;
+
+private:
+	GLsizei vertexCount;
+	GLsizei frameCount;
+	std::vector<Clip> clips;
+	Bounds bakedBounds;
+
+	//Bind pose, only between BeginBake and FinishBake
+	std::vector<glm::vec3> bindPositions, bindNormals;
+	std::vector<glm::uvec4> bindJoints;
+	std::vector<glm::vec4> bindWeights;
+	std::vector<glm::uint64> bakedTexels;	//position and normal of every vertex of every frame, half floats
+	bool baking;
+
+	GLuint frameBuffer;		//bakedTexels once uploaded, 2 RGBA16F texels per vertex per frame
+	GLuint frameTexture;	//texture buffer view of frameBuffer
+};
@@ -0,0 +1,126 @@
+#include "VertexLayout.h"
+
+#include <string.h>
+
+VertexLayout::VertexLayout()
+{
+}
+
+void VertexLayout::AddAttribute(GLuint location, GLint components, GLenum type, GLboolean normalized, bool integer, GLsizei size, GLuint stream)
+{
+	if (stream >= strides.size())
+		strides.resize(stream + 1, 0);
+
+	VertexAttribute attribute;
+	attribute.location = location;
+	attribute.components = components;
+	attribute.type = type;
+	attribute.normalized = normalized;
+	attribute.integer = integer;
+	attribute.stream = stream;
+	attribute.offset = strides[stream];
+	attribute.size = size;
+	attributes.push_back(attribute);
+
+	//Keeping every vertex 4 byte aligned, some GPUs fetch unaligned attributes much slower
+	strides[stream] += (size + 3) & ~3;
+}
+
+void VertexLayout::AddAttributeAt(GLuint location, GLint components, GLenum type, GLboolean normalized, bool integer, GLsizei size, GLuint stream, GLsizei offset)
+{
+	AddAttribute(location, components, type, normalized, integer, size, stream);
+	attributes.back().offset = offset;
+
+	GLsizei end = (offset + size + 3) & ~3;
+	strides[stream] = end > strides[stream] ? end : strides[stream];
+}
+
+void VertexLayout::SetStride(GLuint stream, GLsizei stride)
+{
+	if (stream >= strides.size())
+		strides.resize(stream + 1, 0);
+
+	strides[stream] = stride;
+}
+
+VertexLayout VertexLayout::Positions()
+{
+	return Interleaved<Attribute<POSITION_LOCATION, Float3Format>>();
+}
+
+const VertexAttribute* VertexLayout::FindAttribute(GLuint location) const
+{
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		if (attributes[i].location == location)
+			return &attributes[i];
+	}
+
+	return nullptr;
+}
+
+const float* VertexLayout::FindPositions(const void* const* streams, GLsizei& stride) const
+{
+	const VertexAttribute* position = FindAttribute(POSITION_LOCATION);
+	if (position == nullptr || position->type != GL_FLOAT || position->components != 3)
+		return nullptr;
+
+	stride = strides[position->stream];
+	return (const float*)((const char*)streams[position->stream] + position->offset);
+}
+
+GLsizeiptr VertexLayout::GetStreamSize(GLuint stream, GLsizei numOfVertices) const
+{
+	return (GLsizeiptr)strides[stream] * numOfVertices;
+}
+
+glm::vec4 VertexLayout::ReadAttribute(const VertexAttribute& attribute, const void* vertex)
+{
+	const unsigned char* data = (const unsigned char*)vertex + attribute.offset;
+	GLint components = attribute.components < 4 ? attribute.components : 4;
+	glm::vec4 value(0.0f);
+
+	switch (attribute.type)
+	{
+	case GL_FLOAT:
+		memcpy(&value[0], data, sizeof(float) * components);
+		break;
+	case GL_HALF_FLOAT:
+		for (GLint c = 0; c < components; c++)
+		{
+			GLushort half;
+			memcpy(&half, data + c * sizeof(half), sizeof(half));
+			value[c] = glm::unpackHalf1x16(half);
+		}
+		break;
+	case GL_INT_2_10_10_10_REV:
+	{
+		GLuint packed;
+		memcpy(&packed, data, sizeof(packed));
+		value = glm::unpackSnorm3x10_1x2(packed);
+		break;
+	}
+	case GL_UNSIGNED_BYTE:
+		for (GLint c = 0; c < components; c++)
+			value[c] = attribute.normalized ? data[c] / 255.0f : data[c];
+		break;
+	case GL_BYTE:
+		for (GLint c = 0; c < components; c++)
+			value[c] = attribute.normalized ? glm::max((GLbyte)data[c] / 127.0f, -1.0f) : (GLbyte)data[c];
+		break;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+		for (GLint c = 0; c < components; c++)
+		{
+			GLushort bits;
+			memcpy(&bits, data + c * sizeof(bits), sizeof(bits));
+			if (attribute.type == GL_UNSIGNED_SHORT)
+				value[c] = attribute.normalized ? bits / 65535.0f : bits;
+			else
+				value[c] = attribute.normalized ? glm::max((GLshort)bits / 32767.0f, -1.0f) : (GLshort)bits;
+		}
+		break;
+	}
+
+	return value;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+/*
+Formats an attribute can be stored in on the GPU.
+Smaller formats are expanded back to floats by the GPU when the vertex shader reads them.
+*/
+struct Float2Format { static const GLint components = 2; static const GLenum type = GL_FLOAT; static const GLboolean normalized = GL_FALSE; static const bool integer = false; static const GLsizei size = 8; };
+struct Float3Format { static const GLint components = 3; static const GLenum type = GL_FLOAT; static const GLboolean normalized = GL_FALSE; static const bool integer = false; static const GLsizei size = 12; };
+struct Float4Format { static const GLint components = 4; static const GLenum type = GL_FLOAT; static const GLboolean normalized = GL_FALSE; static const bool integer = false; static const GLsizei size = 16; };
+
+//Half floats, enough precision for texture coordinates
+struct Half2Format { static const GLint components = 2; static const GLenum type = GL_HALF_FLOAT; static const GLboolean normalized = GL_FALSE; static const bool integer = false; static const GLsizei size = 4; };
+struct Half4Format { static const GLint components = 4; static const GLenum type = GL_HALF_FLOAT; static const GLboolean normalized = GL_FALSE; static const bool integer = false; static const GLsizei size = 8; };
+
+//x, y and z in 10 bits each plus 2 bits of w, all in [-1, 1], enough precision for normals and tangents
+struct Snorm10Format { static const GLint components = 4; static const GLenum type = GL_INT_2_10_10_10_REV; static const GLboolean normalized = GL_TRUE; static const bool integer = false; static const GLsizei size = 4; };
+
+//4 bytes in [0, 1], enough precision for colours
+struct Unorm8x4Format { static const GLint components = 4; static const GLenum type = GL_UNSIGNED_BYTE; static const GLboolean normalized = GL_TRUE; static const bool integer = false; static const GLsizei size = 4; };
+
+//4 whole numbers read as a uvec4, bone indices of skinned meshes (up to 256 bones, or 65536 with the shorts)
+struct Uint8x4Format { static const GLint components = 4; static const GLenum type = GL_UNSIGNED_BYTE; static const GLboolean normalized = GL_FALSE; static const bool integer = true; static const GLsizei size = 4; };
+struct Uint16x4Format { static const GLint components = 4; static const GLenum type = GL_UNSIGNED_SHORT; static const GLboolean normalized = GL_FALSE; static const bool integer = true; static const GLsizei size = 8; };
+
+/*
+An attribute of a vertex: the location the shader reads it from and the format it is stored in.
+*/
+template<GLuint Location, typename Format>
+struct Attribute
+{
+	static const GLuint location = Location;
+	typedef Format format;
+};
+
+/*
+Size in bytes of a vertex made of all the attributes interleaved, known at compile time.
+*/
+template<typename... Attributes>
+struct VertexSize;
+
+template<>
+struct VertexSize<>
+{
+	static const GLsizei value = 0;
+};
+
+template<typename First, typename... Rest>
+struct VertexSize<First, Rest...>
+{
+	static const GLsizei value = First::format::size + VertexSize<Rest...>::value;
+};
+
+/*
+Description of one attribute inside a VertexLayout.
+*/
+struct VertexAttribute
+{
+	GLuint location;
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	bool integer;		//read as int/uint by the shader instead of float
+	GLuint stream;		//which array of the mesh the attribute is stored in
+	GLsizei offset;		//byte offset of the attribute inside a vertex of its stream
+	GLsizei size;
+};
+
+/*
+Describes how the vertices of a mesh are stored: which attributes there are, in which format and in which stream.
+A stream is one array of vertex data. Attributes in the same stream are interleaved, one vertex after the other.
+
+Layouts are usually built from a list of Attribute types:
+	VertexLayout::Interleaved<Attribute<0, Float3Format>, Attribute<1, Snorm10Format>, Attribute<2, Half2Format>>()
+*/
+class VertexLayout
+{
+public:
+	VertexLayout();
+
+	/**
+	* Appends an attribute to the end of a stream.
+	*
+	* @param location The attribute location in the shader
+	* @param components How many values the attribute has (1 to 4)
+	* @param type The GL type of each value
+	* @param normalized Whether integer values are mapped to [0, 1] or [-1, 1]
+	* @param integer Whether the shader reads the attribute as an integer
+	* @param size Bytes taken by the attribute
+	* @param stream The stream the attribute is stored in
+	*/
+	void AddAttribute(GLuint location, GLint components, GLenum type, GLboolean normalized, bool integer, GLsizei size, GLuint stream);
+
+	/**
+	* Places an attribute at an offset chosen by the caller, for vertex data laid out by another tool (see GlbModel).
+	* The stream grows to hold the attribute, SetStride can make it wider still.
+	*
+	* @param offset Byte offset of the attribute inside a vertex of the stream
+	*/
+	void AddAttributeAt(GLuint location, GLint components, GLenum type, GLboolean normalized, bool integer, GLsizei size, GLuint stream, GLsizei offset);
+
+	/**
+	* Sets the bytes from one vertex of a stream to the next.
+	*/
+	void SetStride(GLuint stream, GLsizei stride);
+
+	template<typename A>
+	void AddAttribute(GLuint stream)
+	{
+		AddAttribute(A::location, A::format::components, A::format::type, A::format::normalized, A::format::integer, A::format::size, stream);
+	}
+
+	/**
+	* Layout with every attribute in stream 0, one vertex after the other.
+	*/
+	template<typename... Attributes>
+	static VertexLayout Interleaved()
+	{
+		VertexLayout layout;
+		int unused[] = { 0, (layout.AddAttribute<Attributes>(0), 0)... };
+		(void)unused;
+		return layout;
+	}
+
+	/**
+	* Layout with every attribute in its own stream, in the order they are listed.
+	*/
+	template<typename... Attributes>
+	static VertexLayout Split()
+	{
+		VertexLayout layout;
+		GLuint stream = 0;
+		int unused[] = { 0, (layout.AddAttribute<Attributes>(stream++), 0)... };
+		(void)unused;
+		return layout;
+	}
+
+	/**
+	* The layout Mesh has always used, 3 floats of position in stream 0.
+	*/
+	static VertexLayout Positions();
+
+	const std::vector<VertexAttribute>& GetAttributes() const { return attributes; }
+
+	/**
+	* @return The attribute read from a location, nullptr when the layout does not have it
+	*/
+	const VertexAttribute* FindAttribute(GLuint location) const;
+
+	/**
+	* Finds the positions inside the vertex data, when they are stored as 3 floats at POSITION_LOCATION.
+	*
+	* @param streams Vertex data of each stream
+	* @param stride Receives the bytes from one position to the next
+	* @return Position of the first vertex, nullptr if the positions are missing or in another format
+	*/
+	const float* FindPositions(const void* const* streams, GLsizei& stride) const;
+
+	GLuint GetStreamCount() const { return (GLuint)strides.size(); }
+
+	GLsizei GetStride(GLuint stream) const { return strides[stream]; }
+
+	/**
+	* Bytes taken by a stream holding numOfVertices vertices.
+	*/
+	GLsizeiptr GetStreamSize(GLuint stream, GLsizei numOfVertices) const;
+
+	//Locations the shaders read the common attributes from
+	static const GLuint POSITION_LOCATION = 0;
+	static const GLuint NORMAL_LOCATION = 1;
+	static const GLuint UV_LOCATION = 2;
+	static const GLuint COLOUR_LOCATION = 3;
+	static const GLuint TANGENT_LOCATION = 9;
+	//Skinned meshes: 4 bone indices (Uint8x4Format or Uint16x4Format) and their 4 weights (Unorm8x4Format or floats)
+	static const GLuint JOINTS_LOCATION = 10;
+	static const GLuint WEIGHTS_LOCATION = 11;
+
+	/*Packs a unit vector into Snorm10Format*/
+	static GLuint PackNormal(const glm::vec3& normal, float w = 0.0f) { return glm::packSnorm3x10_1x2(glm::vec4(normal, w)); }
+
+	/*Packs a texture coordinate into Half2Format*/
+	static GLuint PackUV(const glm::vec2& uv) { return glm::packHalf2x16(uv); }
+
+	/*Packs a colour in [0, 1] into Unorm8x4Format*/
+	static GLuint PackColour(const glm::vec4& colour) { return glm::packUnorm4x8(colour); }
+
+	/**
+	* Reads an attribute of one vertex back as floats, the way the vertex shader would see it.
+	* Handles floats, half floats, Snorm10Format and 8 or 16 bit integers. Missing components are 0.
+	*
+	* @param vertex Start of the vertex inside its stream
+	*/
+	static glm::vec4 ReadAttribute(const VertexAttribute& attribute, const void* vertex);
+
+private:
+	std::vector<VertexAttribute> attributes;
+	std::vector<GLsizei> strides;
+};
@@ -10,20 +10,26 @@
 #include<glm/gtc/matrix_transform.hpp>
 #include<glm/gtc/type_ptr.hpp>
 
+#include "FrustumCuller.h"
 #include "GLWindow.h"
 #include "Mesh.h"
+#include "MeshPool.h"
 #include "Shader.h"
 
 const float toRadians = 3.14159265f / 180.0f; //equation to convert degrees to radians
 
 
 GLWindow mainWindow;
-std::vector<Mesh*> meshList;
+MeshPool meshPool;
+std::vector<MeshPool::Handle> meshList;
 std::vector<Shader*> shaderList;
 
 // Vertex Shader
 static const char* vShader = "Shaders/shader.vert";
 
+// Vertex Shader reading the model matrix per instance
+static const char* vShaderInstanced = "Shaders/shader_instanced.vert";
+
 //Fragment Shader
 static const char* fShader = "Shaders/shader.frag";
 
@@ -43,13 +49,16 @@ void CreateObjects()
 		0.0f, 1.0f, 0.0f
 	};
 
-	Mesh* obj1 = new Mesh();
-	obj1->CreateMesh(vertices, indices, 12, 12);
+	//Both objects use the same pyramid, sharing the geometry uploads it only once
+	MeshPool::Handle obj1 = meshPool.Create();
+	meshPool.Get(obj1)->CreateMesh(vertices, indices, 12, 12, Mesh::SHARE_GEOMETRY);
 	meshList.push_back(obj1); //To push back to the end of a list
 
-	Mesh* obj2 = new Mesh();
-	obj2->CreateMesh(vertices, indices, 12, 12);
+	MeshPool::Handle obj2 = meshPool.Create();
+	meshPool.Get(obj2)->CreateMesh(vertices, indices, 12, 12, Mesh::SHARE_GEOMETRY);
 	meshList.push_back(obj2); //To push back to the end of a list
+
+	GeometryCache::PrintStats();
 }
 
 void CreateShaders()
@@ -57,6 +66,10 @@ void CreateShaders()
 	Shader* shader1 = new Shader();
 	shader1->CreateFromFiles(vShader, fShader);
 	shaderList.push_back(shader1);
+
+	Shader* shader2 = new Shader();
+	shader2->CreateFromFiles(vShaderInstanced, fShader);
+	shaderList.push_back(shader2);
 }
 
 
@@ -69,7 +82,7 @@ int main() {
 	CreateObjects();
 	CreateShaders();
 
-	GLuint uniformModel = 0, uniformProjection = 0;
+	GLuint uniformProjection = 0;
 
 	//glm perspective tells that we want a perspective matrix
 	//param 1 - field of view in degrees onto y axis
@@ -78,6 +91,15 @@ int main() {
 	//param 4 - the furthest field of view, what is the max distance our camera can perceive objects at
 	glm::mat4 projection = glm::perspective(45.0f, mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
 
+	//One model matrix for every copy of the pyramid
+	std::vector<glm::mat4> instanceModels(2);
+
+	//One culling slot per copy, only the copies in front of the camera are drawn
+	FrustumCuller culler;
+	for (size_t i = 0; i < instanceModels.size(); i++)
+		culler.Add(Bounds());
+	std::vector<glm::mat4> visibleModels;
+
 	//Loop until window closed
 	while (!mainWindow.getShouldClose())
 	{
@@ -90,30 +112,38 @@ int main() {
 		//Clearing both the colour and depth buffer bit
 
 		//Asks the GPU to run the shader program with the chosen id
-		shaderList[0]->UseShader();
-		uniformModel = shaderList[0]->GetModelLocation();
-		uniformProjection = shaderList[0]->GetProjectionLocation();
+		shaderList[1]->UseShader();
+		uniformProjection = shaderList[1]->GetProjectionLocation();
 
 		//Var type of a matrix4x4 (identity matrix, all values are zeros besides the diagonal one)
 		glm::mat4 model(1.0f);
 
-
-
 		model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f)); //translation to the identity matrix by a precise vector 3 
 		model = glm::scale(model, glm::vec3(.4f, .4f, 1.0f));
-		
+		instanceModels[0] = model;
+
+		model = glm::mat4(1.0f);
+		model = glm::translate(model, glm::vec3(0.0f, 1.0f, -2.5f));
+		model = glm::scale(model, glm::vec3(.4f, .4f, 1.0f));
+		instanceModels[1] = model;
 
 		//assign value to the shader program
 		//the value pointer because we need a raw format of the value model that will work with the shader
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
 		glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projection));
-		meshList[0]->RenderMesh();
 
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 1.0f, -2.5f));
-		model = glm::scale(model, glm::vec3(.4f, .4f, 1.0f));
-		glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-		meshList[1]->RenderMesh();
+		//Both pyramids share the same mesh, the visible ones are drawn with one instanced call
+		Mesh* pyramid = meshPool.Get(meshList[0]);
+		for (size_t i = 0; i < instanceModels.size(); i++)
+			culler.Update((unsigned int)i, pyramid->GetWorldBounds(instanceModels[i]));
+
+		//There is no view matrix yet, the models are already in camera space
+		const std::vector<unsigned int>& visible = culler.Cull(projection);
+		visibleModels.clear();
+		for (size_t i = 0; i < visible.size(); i++)
+			visibleModels.push_back(instanceModels[visible[i]]);
+
+		if (!visibleModels.empty())
+			pyramid->RenderMeshInstanced(visibleModels.data(), (GLsizei)visibleModels.size());
 
 		//Unassign the shader program
 		glUseProgram(0);
@@ -122,5 +152,9 @@ int main() {
 		mainWindow.swapBuffer();
 	}
 
+	//Every mesh is cleared while the context still exists
+	meshPool.ReleaseAll();
+	meshList.clear();
+
 	return 0;
 }
\ No newline at end of file